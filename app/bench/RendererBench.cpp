@@ -0,0 +1,193 @@
+// Microbenchmarks for the renderer hot paths. Run `renderer_bench --benchmark_filter=<regex>`.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "Renderer.h"
+#include "Scenes.h"
+#include "Utils.h"
+
+/// @brief Friend of `Renderer` and `Camera`, exposes their private hot paths.
+struct BenchmarkAccess {
+    static auto TraceRay(Renderer& renderer, const Ray& ray) { return renderer.TraceRay(ray); }
+    static auto PerPixel(Renderer& renderer, uint32_t x, uint32_t y) { return renderer.PerPixel(x, y); }
+    static void RecalculateRayBasis(Camera& camera) { camera.RecalculateRayBasis(); }
+    static void UpdateRayCache(Renderer& renderer, const Camera& camera) { renderer.UpdateRayCache(camera); }
+};
+
+namespace {
+
+// clang-format off
+constexpr uint32_t SceneSizes[] = { 3, 1'000, 100'000 };
+constexpr uint32_t Resolutions[][2] = { { 320, 180 }, { 1280, 720 }, { 1920, 1080 } };
+// clang-format on
+
+/// @brief Canonical scenes by index into `SceneSizes`, generated once.
+const std::shared_ptr<const Scene>& GetScene(int64_t idx)
+{
+    static std::shared_ptr<const Scene> scenes[std::size(SceneSizes)];
+
+    auto& scene = scenes[idx];
+    if (!scene) {
+        scene = std::make_shared<const Scene>(SceneSizes[idx] == 3 ? Scenes::Default() : Scenes::RandomSpheres(SceneSizes[idx]));
+    }
+    return scene;
+}
+
+void SetSceneLabel(benchmark::State& state, int64_t sceneIdx)
+{
+    state.SetLabel(std::to_string(SceneSizes[sceneIdx]) + " spheres");
+}
+
+/// @brief Renderer that has seen one frame, so the BVH and the active scene/camera are set up.
+struct Fixture {
+    Camera Cam { 45.0f, 0.1f, 100.0f };
+    Renderer Rndr;
+
+    Fixture(std::shared_ptr<const Scene> scene, uint32_t width, uint32_t height, bool cacheRays = false)
+    {
+        Rndr.GetSettings().CacheRayDirections = cacheRays;
+        Cam.OnResize(width, height);
+        Rndr.OnResize(width, height);
+        Rndr.SetScene(std::move(scene));
+        Rndr.Render(Cam);
+    }
+};
+
+void BM_TraceRay(benchmark::State& state)
+{
+    const auto& scene = GetScene(state.range(0));
+    Fixture fixture(scene, 320, 180);
+
+    std::vector<glm::vec3> directions;
+    for (uint32_t y = 0; y < 180; y++) {
+        for (uint32_t x = 0; x < 320; x++) {
+            directions.push_back(fixture.Cam.GetRayDirection(x, y));
+        }
+    }
+    size_t idx = 0;
+
+    for (auto _ : state) {
+        Ray ray { fixture.Cam.GetPosition(), directions[idx] };
+        benchmark::DoNotOptimize(BenchmarkAccess::TraceRay(fixture.Rndr, ray));
+
+        idx = idx + 1 == directions.size() ? 0 : idx + 1;
+    }
+
+    state.counters["rays/s"] = benchmark::Counter((double)state.iterations(), benchmark::Counter::kIsRate);
+    SetSceneLabel(state, state.range(0));
+}
+
+void BM_PerPixel(benchmark::State& state)
+{
+    const auto& scene = GetScene(state.range(0));
+    const uint32_t width = 320, height = 180;
+    const bool cacheRays = state.range(1);
+    Fixture fixture(scene, width, height, cacheRays);
+
+    uint32_t x = 0, y = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BenchmarkAccess::PerPixel(fixture.Rndr, x, y));
+
+        if (++x == width) {
+            x = 0;
+            y = y + 1 == height ? 0 : y + 1;
+        }
+    }
+
+    state.counters["pixel time"] = benchmark::Counter((double)state.iterations(),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetLabel(std::to_string(SceneSizes[state.range(0)]) + " spheres, " + (cacheRays ? "cached rays" : "rays on the fly"));
+}
+
+/// @brief Camera moved: new ray basis, then the renderer's parallel ray cache refill.
+void BM_RecalculateRayDirections(benchmark::State& state)
+{
+    auto [width, height] = Resolutions[state.range(0)];
+    Fixture fixture(GetScene(0), width, height, true);
+
+    for (auto _ : state) {
+        BenchmarkAccess::RecalculateRayBasis(fixture.Cam);
+        BenchmarkAccess::UpdateRayCache(fixture.Rndr, fixture.Cam);
+    }
+
+    state.counters["pixel time"] = benchmark::Counter((double)state.iterations() * width * height,
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetLabel(std::to_string(width) + "x" + std::to_string(height));
+}
+
+void BM_Vec2Rgba(benchmark::State& state)
+{
+    std::vector<glm::vec4> colors(4096);
+    for (size_t i = 0; i < colors.size(); i++) {
+        float t = (float)i / (float)colors.size();
+        colors[i] = { t, 1.0f - t, t * t, 1.0f };
+    }
+
+    std::vector<uint32_t> pixels(colors.size());
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < colors.size(); i++) {
+            pixels[i] = Utils::Vec2Rgba(colors[i]);
+        }
+        benchmark::DoNotOptimize(pixels.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["pixel time"] = benchmark::Counter((double)state.iterations() * colors.size(),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_ResolveRow(benchmark::State& state)
+{
+    std::vector<glm::vec3> accum(4096);
+    for (size_t i = 0; i < accum.size(); i++) {
+        float t = (float)i / (float)accum.size();
+        accum[i] = glm::vec3 { t, 1.0f - t, t * t } * 16.0f;
+    }
+
+    std::vector<uint32_t> pixels(accum.size());
+
+    for (auto _ : state) {
+        Utils::ResolveRow(accum.data(), (uint32_t)accum.size(), { .Scale = 1.0f / 16.0f }, pixels.data());
+        benchmark::DoNotOptimize(pixels.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["pixel time"] = benchmark::Counter((double)state.iterations() * accum.size(),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_Render(benchmark::State& state)
+{
+    const auto& scene = GetScene(state.range(0));
+    auto [width, height] = Resolutions[state.range(1)];
+    Fixture fixture(scene, width, height);
+
+    for (auto _ : state) {
+        fixture.Rndr.Render(fixture.Cam);
+    }
+
+    // Paths per second, a path traces up to `Bounces` rays so this is not comparable to `BM_TraceRay`.
+    double pixels = (double)state.iterations() * width * height;
+    state.counters["pixels/s"] = benchmark::Counter(pixels, benchmark::Counter::kIsRate);
+    state.counters["pixel time"] = benchmark::Counter(pixels, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+
+    state.SetLabel(std::to_string(SceneSizes[state.range(0)]) + " spheres, "
+        + std::to_string(width) + "x" + std::to_string(height));
+}
+
+} // namespace
+
+BENCHMARK(BM_TraceRay)->DenseRange(0, 2);
+BENCHMARK(BM_PerPixel)->ArgsProduct({ { 0, 1, 2 }, { 0, 1 } });
+BENCHMARK(BM_RecalculateRayDirections)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Vec2Rgba);
+BENCHMARK(BM_ResolveRow);
+BENCHMARK(BM_Render)->ArgsProduct({ { 0, 1, 2 }, { 0, 1, 2 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,259 @@
+#include "BVH.h"
+
+#include <algorithm> // max, nth_element, partition
+#include <limits>
+#include <numeric> // iota
+#include <utility> // move
+
+namespace {
+
+constexpr uint32_t BinCount = 16;
+
+struct Bin {
+    AABB Bounds;
+    uint32_t Count = 0;
+};
+
+} // namespace
+
+void BVH::Build(std::span<const AABB> primBounds, uint32_t leafSize)
+{
+    m_Nodes.clear();
+    m_PrimIndices.resize(primBounds.size());
+    std::iota(std::begin(m_PrimIndices), std::end(m_PrimIndices), 0);
+
+    if (primBounds.empty()) {
+        return;
+    }
+
+    m_Centroids.resize(primBounds.size());
+    for (size_t i = 0; i < primBounds.size(); i++) {
+        m_Centroids[i] = primBounds[i].Center();
+    }
+
+    // A binary tree with N leaves has 2N - 1 nodes.
+    m_Nodes.reserve(primBounds.size() * 2 - 1);
+    m_Nodes.push_back(BVHNode {
+        .LeftFirst = 0,
+        .Count = (uint32_t)primBounds.size(),
+    });
+
+    UpdateNodeBounds(0, primBounds);
+    Subdivide(0, primBounds, leafSize, 0);
+
+    m_Nodes.shrink_to_fit();
+    m_Centroids.clear();
+}
+
+void BVH::Refit(std::span<const AABB> primBounds)
+{
+    if (primBounds.size() != m_PrimIndices.size()) {
+        Build(primBounds);
+        return;
+    }
+
+    // Children are always pushed after their parent, so walking backwards visits them first.
+    for (size_t i = m_Nodes.size(); i-- > 0;) {
+        auto& node = m_Nodes[i];
+
+        if (node.IsLeaf()) {
+            UpdateNodeBounds((uint32_t)i, primBounds);
+            continue;
+        }
+
+        const auto& left = m_Nodes[node.LeftFirst];
+        const auto& right = m_Nodes[node.LeftFirst + 1];
+        node.Min = glm::min(left.Min, right.Min);
+        node.Max = glm::max(left.Max, right.Max);
+    }
+}
+
+bool BVH::Assign(std::vector<BVHNode> nodes, std::vector<uint32_t> primIndices, size_t primCount)
+{
+    m_Nodes.clear();
+    m_PrimIndices.clear();
+
+    if (primIndices.size() != primCount || nodes.empty() != primIndices.empty()) {
+        return false;
+    }
+
+    // Traversal trusts these ranges, a corrupt file must not send it out of bounds, in circles or past
+    // its stack. Children always come after their parent, so one pass assigns every depth before use,
+    // and a node must not be the child of two parents.
+    constexpr uint32_t Unreached = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> depths(nodes.size(), Unreached);
+    if (!depths.empty()) {
+        depths[0] = 0;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        auto& node = nodes[i];
+        if (depths[i] == Unreached) {
+            return false;
+        }
+
+        bool inRange = node.IsLeaf()
+            ? (size_t)node.LeftFirst + node.Count <= primIndices.size()
+            : node.LeftFirst > i && (size_t)node.LeftFirst + 1 < nodes.size() && depths[i] < MaxDepth;
+        if (!inRange) {
+            return false;
+        }
+
+        if (!node.IsLeaf()) {
+            for (uint32_t child = node.LeftFirst; child <= node.LeftFirst + 1; child++) {
+                if (depths[child] != Unreached) {
+                    return false;
+                }
+                depths[child] = depths[i] + 1;
+            }
+        }
+    }
+
+    for (uint32_t primIdx : primIndices) {
+        if (primIdx >= primCount) {
+            return false;
+        }
+    }
+
+    m_Nodes = std::move(nodes);
+    m_PrimIndices = std::move(primIndices);
+    return true;
+}
+
+void BVH::UpdateNodeBounds(uint32_t nodeIdx, std::span<const AABB> primBounds)
+{
+    auto& node = m_Nodes[nodeIdx];
+
+    AABB bounds;
+    for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.Count; i++) {
+        bounds.Grow(primBounds[m_PrimIndices[i]]);
+    }
+
+    node.Min = bounds.Min;
+    node.Max = bounds.Max;
+}
+
+uint32_t BVH::SplitMedian(uint32_t first, uint32_t count, const AABB& centroidBounds)
+{
+    glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    auto begin = std::begin(m_PrimIndices) + first;
+    std::nth_element(begin, begin + count / 2, begin + count, [&](uint32_t a, uint32_t b) {
+        return m_Centroids[a][axis] < m_Centroids[b][axis];
+    });
+
+    return count / 2;
+}
+
+void BVH::Subdivide(uint32_t nodeIdx, std::span<const AABB> primBounds, uint32_t leafSize, uint32_t depth)
+{
+    uint32_t first = m_Nodes[nodeIdx].LeftFirst;
+    uint32_t count = m_Nodes[nodeIdx].Count;
+
+    if (count <= std::max(leafSize, 1u) || depth >= MaxDepth) {
+        return;
+    }
+
+    AABB centroidBounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        centroidBounds.Grow(m_Centroids[m_PrimIndices[i]]);
+    }
+
+    // Halving from here reaches single primitives by `MaxDepth`, whatever their count.
+    if (depth >= MaxDepth - 32) {
+        AddChildren(nodeIdx, SplitMedian(first, count, centroidBounds), primBounds, leafSize, depth);
+        return;
+    }
+
+    // Binned SAH: cost of a split is `area(left) * count(left) + area(right) * count(right)`.
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+
+    for (int axis = 0; axis < 3; axis++) {
+        float lo = centroidBounds.Min[axis], hi = centroidBounds.Max[axis];
+        if (lo == hi) {
+            continue;
+        }
+
+        Bin bins[BinCount];
+        float scale = BinCount / (hi - lo);
+
+        for (uint32_t i = first; i < first + count; i++) {
+            uint32_t primIdx = m_PrimIndices[i];
+            auto binIdx = std::min(BinCount - 1, (uint32_t)((m_Centroids[primIdx][axis] - lo) * scale));
+
+            bins[binIdx].Count++;
+            bins[binIdx].Bounds.Grow(primBounds[primIdx]);
+        }
+
+        // Sweep from both sides, so every split plane is evaluated in O(BinCount).
+        float leftArea[BinCount - 1], rightArea[BinCount - 1];
+        uint32_t leftCount[BinCount - 1], rightCount[BinCount - 1];
+
+        AABB leftBox, rightBox;
+        uint32_t leftSum = 0, rightSum = 0;
+
+        for (uint32_t i = 0; i < BinCount - 1; i++) {
+            leftSum += bins[i].Count;
+            leftCount[i] = leftSum;
+            leftBox.Grow(bins[i].Bounds);
+            leftArea[i] = leftBox.HalfArea();
+
+            rightSum += bins[BinCount - 1 - i].Count;
+            rightCount[BinCount - 2 - i] = rightSum;
+            rightBox.Grow(bins[BinCount - 1 - i].Bounds);
+            rightArea[BinCount - 2 - i] = rightBox.HalfArea();
+        }
+
+        for (uint32_t i = 0; i < BinCount - 1; i++) {
+            if (leftCount[i] == 0 || rightCount[i] == 0) {
+                continue;
+            }
+
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    // All centroids coincide, or no split is cheaper than intersecting everything.
+    AABB nodeBounds { m_Nodes[nodeIdx].Min, m_Nodes[nodeIdx].Max };
+    if (bestAxis < 0 || bestCost >= count * nodeBounds.HalfArea()) {
+        return;
+    }
+
+    float lo = centroidBounds.Min[bestAxis];
+    float scale = BinCount / (centroidBounds.Max[bestAxis] - lo);
+
+    auto mid = std::partition(std::begin(m_PrimIndices) + first, std::begin(m_PrimIndices) + first + count,
+        [&](uint32_t primIdx) {
+            auto binIdx = std::min(BinCount - 1, (uint32_t)((m_Centroids[primIdx][bestAxis] - lo) * scale));
+            return binIdx <= bestSplit;
+        });
+
+    AddChildren(nodeIdx, (uint32_t)(mid - std::begin(m_PrimIndices)) - first, primBounds, leafSize, depth);
+}
+
+void BVH::AddChildren(uint32_t nodeIdx, uint32_t leftSize, std::span<const AABB> primBounds, uint32_t leafSize, uint32_t depth)
+{
+    uint32_t first = m_Nodes[nodeIdx].LeftFirst;
+    uint32_t count = m_Nodes[nodeIdx].Count;
+
+    auto leftIdx = (uint32_t)m_Nodes.size();
+    m_Nodes.push_back(BVHNode { .LeftFirst = first, .Count = leftSize });
+    m_Nodes.push_back(BVHNode { .LeftFirst = first + leftSize, .Count = count - leftSize });
+
+    m_Nodes[nodeIdx].LeftFirst = leftIdx;
+    m_Nodes[nodeIdx].Count = 0;
+
+    UpdateNodeBounds(leftIdx, primBounds);
+    UpdateNodeBounds(leftIdx + 1, primBounds);
+
+    Subdivide(leftIdx, primBounds, leafSize, depth + 1);
+    Subdivide(leftIdx + 1, primBounds, leafSize, depth + 1);
+}
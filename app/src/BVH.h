@@ -0,0 +1,194 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "Ray.h"
+
+/// @brief Axis aligned bounding box. Default constructed box is empty (inverted).
+struct AABB {
+    glm::vec3 Min { std::numeric_limits<float>::max() };
+    glm::vec3 Max { std::numeric_limits<float>::lowest() };
+
+    void Grow(const glm::vec3& point)
+    {
+        Min = glm::min(Min, point);
+        Max = glm::max(Max, point);
+    }
+
+    void Grow(const AABB& box)
+    {
+        Min = glm::min(Min, box.Min);
+        Max = glm::max(Max, box.Max);
+    }
+
+    glm::vec3 Center() const { return (Min + Max) * 0.5f; }
+
+    /// @brief Half of the surface area, enough for SAH cost comparisons.
+    float HalfArea() const
+    {
+        glm::vec3 e = Max - Min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+/**
+ * @brief Node of the flattened tree, 32 bytes so two of them share a cache line.
+ * Interior nodes store the index of the left child, the right child is always next to it.
+ * Leaves store a range into @ref `BVH::GetPrimIndices`.
+ */
+struct BVHNode {
+    glm::vec3 Min { 0.0f };
+    uint32_t LeftFirst = 0;
+    glm::vec3 Max { 0.0f };
+    uint32_t Count = 0;
+
+    bool IsLeaf() const { return Count > 0; }
+};
+
+/// @brief Bounding volume hierarchy over any kind of primitive, only their bounds are needed.
+class BVH {
+public:
+    /// @brief Levels below the root a leaf may be at most, bounds the traversal stack.
+    static constexpr uint32_t MaxDepth = 63;
+
+    /**
+     * @brief Binned SAH build. Skewed inputs can make SAH trees as deep as they have primitives, so
+     * nodes below @ref `MaxDepth` - 32 are split at the median instead, which reaches single
+     * primitives within 32 levels. Primitives are referenced by their index in `primBounds`.
+     * @param leafSize Nodes with this many primitives or fewer are never split. Raise it to the
+     * width of a SIMD leaf kernel, so its lanes are not wasted.
+     */
+    void Build(std::span<const AABB> primBounds, uint32_t leafSize = 2);
+
+    /**
+     * @brief Recompute node bounds bottom-up, keeping the tree topology.
+     * Cheap update for moved primitives, `primBounds` must have as many entries as the last build.
+     */
+    void Refit(std::span<const AABB> primBounds);
+
+    /**
+     * @brief Adopts a tree built earlier, e.g. read back by @ref `SceneCache::Load`.
+     * @return False, leaving the BVH empty, if the nodes are not a tree of at most @ref `MaxDepth` levels
+     * indexing `primCount` primitives consistently.
+     */
+    bool Assign(std::vector<BVHNode> nodes, std::vector<uint32_t> primIndices, size_t primCount);
+
+    bool Empty() const { return m_Nodes.empty(); }
+    size_t GetPrimCount() const { return m_PrimIndices.size(); }
+
+    const std::vector<BVHNode>& GetNodes() const { return m_Nodes; }
+    const std::vector<uint32_t>& GetPrimIndices() const { return m_PrimIndices; }
+
+    /**
+     * @brief Visit every leaf whose box is hit closer than `tMax`, nearest child first.
+     * @param tMax Closest hit so far. Read again after every leaf, so `intersectLeaf` may shrink it.
+     * @param intersectLeaf Called with `(first, count)`, a range into @ref `GetPrimIndices`.
+     */
+    template <typename Fn>
+    void Traverse(const Ray& ray, const float& tMax, Fn&& intersectLeaf) const;
+
+private:
+    void UpdateNodeBounds(uint32_t nodeIdx, std::span<const AABB> primBounds);
+    void Subdivide(uint32_t nodeIdx, std::span<const AABB> primBounds, uint32_t leafSize, uint32_t depth);
+    /// @brief Orders the range so its first half has the smaller centroids along their longest axis.
+    /// @return Size of the left half.
+    uint32_t SplitMedian(uint32_t first, uint32_t count, const AABB& centroidBounds);
+    /// @brief Turns the leaf into an interior node over its first `leftSize` primitives and the rest, then subdivides both.
+    void AddChildren(uint32_t nodeIdx, uint32_t leftSize, std::span<const AABB> primBounds, uint32_t leafSize, uint32_t depth);
+
+    /// @brief Slab test, returns entry distance or `Inf` on a miss.
+    static float IntersectAABB(const Ray& ray, const glm::vec3& invDir,
+        const glm::vec3& bMin, const glm::vec3& bMax, float tMax);
+
+private:
+    std::vector<BVHNode> m_Nodes;
+    std::vector<uint32_t> m_PrimIndices;
+    std::vector<glm::vec3> m_Centroids;
+};
+
+inline float BVH::IntersectAABB(const Ray& ray, const glm::vec3& invDir,
+    const glm::vec3& bMin, const glm::vec3& bMax, float tMax)
+{
+    glm::vec3 t0 = (bMin - ray.Origin) * invDir;
+    glm::vec3 t1 = (bMax - ray.Origin) * invDir;
+
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    float tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+    float tExit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+
+    if (tExit >= tEnter && tExit > 0.0f && tEnter < tMax) {
+        return tEnter;
+    }
+
+    return std::numeric_limits<float>::max();
+}
+
+template <typename Fn>
+void BVH::Traverse(const Ray& ray, const float& tMax, Fn&& intersectLeaf) const
+{
+    if (m_Nodes.empty()) {
+        return;
+    }
+
+    constexpr float Inf = std::numeric_limits<float>::max();
+    const glm::vec3 invDir = 1.0f / ray.Direction;
+
+    // One pending far child per level at most, `Build` and `Assign` keep leaves within `MaxDepth`.
+    uint32_t stack[MaxDepth];
+    uint32_t stackPtr = 0;
+
+    const BVHNode* node = &m_Nodes[0];
+    if (IntersectAABB(ray, invDir, node->Min, node->Max, tMax) == Inf) {
+        return;
+    }
+
+    while (true) {
+        if (node->IsLeaf()) {
+            intersectLeaf(node->LeftFirst, node->Count);
+
+            if (stackPtr == 0) {
+                break;
+            }
+            node = &m_Nodes[stack[--stackPtr]];
+            continue;
+        }
+
+        uint32_t nearIdx = node->LeftFirst, farIdx = node->LeftFirst + 1;
+        const BVHNode& left = m_Nodes[nearIdx];
+        const BVHNode& right = m_Nodes[farIdx];
+
+        float tNear = IntersectAABB(ray, invDir, left.Min, left.Max, tMax);
+        float tFar = IntersectAABB(ray, invDir, right.Min, right.Max, tMax);
+
+        if (tNear > tFar) {
+            std::swap(tNear, tFar);
+            std::swap(nearIdx, farIdx);
+        }
+
+        if (tNear == Inf) {
+            if (stackPtr == 0) {
+                break;
+            }
+            node = &m_Nodes[stack[--stackPtr]];
+            continue;
+        }
+
+        node = &m_Nodes[nearIdx];
+        if (tFar != Inf) {
+            assert(stackPtr < MaxDepth);
+            stack[stackPtr++] = farIdx;
+        }
+    }
+}
+
+#endif // BVH_H
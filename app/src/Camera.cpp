@@ -1,12 +1,7 @@
 #include "Camera.h"
+#include "Walnut/Profiler.h"
 
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
-
-#include "Walnut/Input/Input.h"
-
-using namespace Walnut;
 
 Camera::Camera(float verticalFOV, float nearClip, float farClip)
     : m_VerticalFOV(verticalFOV)
@@ -17,78 +12,6 @@ Camera::Camera(float verticalFOV, float nearClip, float farClip)
     m_Position = glm::vec3(0, 0, 3);
 }
 
-bool Camera::OnUpdate(float ts)
-{
-    glm::vec2 mousePos = Input::GetMousePosition();
-    glm::vec2 delta = (mousePos - m_LastMousePosition) * 0.002f;
-    m_LastMousePosition = mousePos;
-
-    if (!Input::IsMouseButtonDown(MouseButton::Right)) {
-        Input::SetCursorMode(CursorMode::Normal);
-        return false;
-    }
-
-    Input::SetCursorMode(CursorMode::Locked);
-
-    bool moved = false;
-
-    // no tilting, so up can be constant.
-    constexpr glm::vec3 upDirection(0.0f, 1.0f, 0.0f);
-    glm::vec3 rightDirection = glm::cross(m_ForwardDirection, upDirection);
-
-    float speed = 5.0f;
-    if (Input::IsKeyDown(KeyCode::LeftShift)) {
-        speed = 50.0f;
-    }
-
-    // Movement
-    if (Input::IsKeyDown(KeyCode::W)) {
-        m_Position += m_ForwardDirection * speed * ts;
-        moved = true;
-    } else if (Input::IsKeyDown(KeyCode::S)) {
-        m_Position -= m_ForwardDirection * speed * ts;
-        moved = true;
-    }
-
-    if (Input::IsKeyDown(KeyCode::A)) {
-        m_Position -= rightDirection * speed * ts;
-        moved = true;
-    } else if (Input::IsKeyDown(KeyCode::D)) {
-        m_Position += rightDirection * speed * ts;
-        moved = true;
-    }
-
-    if (Input::IsKeyDown(KeyCode::Q)) {
-        m_Position -= upDirection * speed * ts;
-        moved = true;
-    } else if (Input::IsKeyDown(KeyCode::E)) {
-        m_Position += upDirection * speed * ts;
-        moved = true;
-    }
-
-    // Rotation
-    if (delta.x != 0.0f || delta.y != 0.0f) {
-        float pitchDelta = delta.y * GetRotationSpeed();
-        float yawDelta = delta.x * GetRotationSpeed();
-
-        auto combinedAngle = glm::cross(
-            glm::angleAxis(-pitchDelta, rightDirection),
-            glm::angleAxis(-yawDelta, glm::vec3(0.f, 1.0f, 0.0f)));
-
-        glm::quat q = glm::normalize(combinedAngle);
-        m_ForwardDirection = glm::rotate(q, m_ForwardDirection);
-
-        moved = true;
-    }
-
-    if (moved) {
-        RecalculateView();
-        RecalculateRayDirections();
-    }
-
-    return moved;
-}
-
 void Camera::OnResize(uint32_t width, uint32_t height)
 {
     if (width == m_ViewportWidth && height == m_ViewportHeight)
@@ -98,7 +21,7 @@ void Camera::OnResize(uint32_t width, uint32_t height)
     m_ViewportHeight = height;
 
     RecalculateProjection();
-    RecalculateRayDirections();
+    RecalculateRayBasis();
 }
 
 float Camera::GetRotationSpeed()
@@ -118,18 +41,23 @@ void Camera::RecalculateView()
     m_InverseView = glm::inverse(m_View);
 }
 
-void Camera::RecalculateRayDirections()
+void Camera::RecalculateRayBasis()
 {
-    m_RayDirections.resize(m_ViewportWidth * m_ViewportHeight);
+    WL_PROFILE_SCOPE("Camera::RecalculateRayBasis");
+
+    // Projection and view are affine for w = 0, only the normalize is not. Evaluate the
+    // full transform at three pixels and step linearly in between.
+    auto unnormalized = [this](float x, float y) {
+        glm::vec2 coord = { x / (float)m_ViewportWidth, y / (float)m_ViewportHeight };
+        coord = coord * 2.0f - 1.0f; // -1 -> 1
+
+        glm::vec4 target = m_InverseProjection * glm::vec4(coord.x, coord.y, 1, 1);
+        return glm::vec3(m_InverseView * glm::vec4(glm::vec3(target) / target.w, 0)); // World space
+    };
 
-    for (uint32_t y = 0; y < m_ViewportHeight; y++) {
-        for (uint32_t x = 0; x < m_ViewportWidth; x++) {
-            glm::vec2 coord = { (float)x / (float)m_ViewportWidth, (float)y / (float)m_ViewportHeight };
-            coord = coord * 2.0f - 1.0f; // -1 -> 1
+    m_RayCorner = unnormalized(0.0f, 0.0f);
+    m_RayStepX = unnormalized(1.0f, 0.0f) - m_RayCorner;
+    m_RayStepY = unnormalized(0.0f, 1.0f) - m_RayCorner;
 
-            glm::vec4 target = m_InverseProjection * glm::vec4(coord.x, coord.y, 1, 1);
-            glm::vec3 rayDirection = glm::vec3(m_InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0)); // World space
-            m_RayDirections[x + y * m_ViewportWidth] = rayDirection;
-        }
-    }
+    m_RayVersion++;
 }
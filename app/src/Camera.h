@@ -2,7 +2,8 @@
 #define CAMERA_H
 
 #include <glm/glm.hpp>
-#include <vector>
+
+#include <cstdint>
 
 /// @brief Controls camera position and movement. Pass an instance of it to renderer.
 class Camera {
@@ -13,6 +14,7 @@ public:
      * @brief Check mouse for rotation and keys for translation.
      * @param ts timestep, also called delta-time.
      * @return true if camera moved.
+     * @note Defined in `CameraInput.cpp`, the only part of the camera that needs Walnut's input.
      */
     bool OnUpdate(float ts);
     void OnResize(uint32_t width, uint32_t height);
@@ -25,16 +27,28 @@ public:
     const glm::vec3& GetPosition() const { return m_Position; }
     const glm::vec3& GetDirection() const { return m_ForwardDirection; }
 
-    /// @brief A ray for every viewport fragment is calculated.
-    const std::vector<glm::vec3>& GetRayDirections() const { return m_RayDirections; }
+    /**
+     * @brief World space direction of the primary ray through pixel `(x, y)`.
+     * Directions are affine in the pixel coordinates before normalizing, so this is a couple of
+     * multiply-adds instead of two matrix multiplies.
+     */
+    glm::vec3 GetRayDirection(uint32_t x, uint32_t y) const
+    {
+        return glm::normalize(m_RayCorner + (float)x * m_RayStepX + (float)y * m_RayStepY);
+    }
+
+    /// @brief Bumped every time the primary rays change, lets renderers keep a ray cache in sync.
+    uint32_t GetRayVersion() const { return m_RayVersion; }
 
     /// @brief Used to adjust mouse sensitivity.
     float GetRotationSpeed();
 
 private:
+    friend struct BenchmarkAccess;
+
     void RecalculateProjection();
     void RecalculateView();
-    void RecalculateRayDirections();
+    void RecalculateRayBasis();
 
 private:
     glm::mat4 m_Projection { 1.0f };
@@ -49,8 +63,9 @@ private:
     glm::vec3 m_Position { 0.0f, 0.0f, 0.0f };
     glm::vec3 m_ForwardDirection { 0.0f, 0.0f, 0.0f };
 
-    /// @brief Cached ray directions calculated by @ref `RecalculateRayDirections`
-    std::vector<glm::vec3> m_RayDirections;
+    /// @brief Unnormalized direction through pixel `(0, 0)` and the step to the next pixel along x and y.
+    glm::vec3 m_RayCorner { 0.0f }, m_RayStepX { 0.0f }, m_RayStepY { 0.0f };
+    uint32_t m_RayVersion = 0;
 
     glm::vec2 m_LastMousePosition { 0.0f, 0.0f };
 
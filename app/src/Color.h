@@ -22,6 +22,7 @@ constexpr glm::vec3
     White { 1.0f },
     Black { 0.0f },
 
+    Slate_300  = FromHex(0xcbd5e1),
     Slate_800  = FromHex(0x1e293b),
     Slate_900  = FromHex(0x0f172a),
     Slate_950  = FromHex(0x020617),
@@ -0,0 +1,221 @@
+#include "ImageIO.h"
+
+#include <fmt/format.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm> // max
+#include <cmath> // frexp
+#include <cstring> // memcpy
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+/// @brief Little endian, the byte order of both EXR and of every platform the renderer targets.
+class ByteWriter {
+public:
+    template <typename T>
+    void Put(T value)
+    {
+        size_t offset = m_Bytes.size();
+        m_Bytes.resize(offset + sizeof(T));
+        std::memcpy(m_Bytes.data() + offset, &value, sizeof(T));
+    }
+
+    void PutString(std::string_view str)
+    {
+        m_Bytes.insert(m_Bytes.end(), str.begin(), str.end());
+        m_Bytes.push_back('\0');
+    }
+
+    /// @brief EXR header attribute: name, type, size in bytes, then the value written by `value`.
+    template <typename F>
+    void PutAttribute(std::string_view name, std::string_view type, F&& value)
+    {
+        PutString(name);
+        PutString(type);
+
+        size_t sizeOffset = m_Bytes.size();
+        Put<int32_t>(0);
+        value();
+
+        auto size = (int32_t)(m_Bytes.size() - sizeOffset - sizeof(int32_t));
+        std::memcpy(m_Bytes.data() + sizeOffset, &size, sizeof(size));
+    }
+
+    size_t Size() const { return m_Bytes.size(); }
+    const std::vector<char>& Bytes() const { return m_Bytes; }
+
+private:
+    std::vector<char> m_Bytes;
+};
+
+bool WriteFile(const std::filesystem::path& path, const std::vector<char>& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), (std::streamsize)bytes.size());
+    if (!file) {
+        fmt::println(stderr, "Error: could not write '{}'", path.string());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool ImageIO::WriteExr(const std::filesystem::path& path, uint32_t width, uint32_t height, const glm::vec4* pixels)
+{
+    constexpr int32_t Magic = 20000630;
+    constexpr int32_t Version = 2; // Single part scanline image
+    constexpr int32_t PixelTypeFloat = 2;
+    // Readers expect the channels sorted by name.
+    constexpr char Channels[] = { 'A', 'B', 'G', 'R' };
+    constexpr int ChannelIndex[] = { 3, 2, 1, 0 };
+
+    ByteWriter out;
+    out.Put(Magic);
+    out.Put(Version);
+
+    out.PutAttribute("channels", "chlist", [&]() {
+        for (char channel : Channels) {
+            out.PutString(std::string_view(&channel, 1));
+            out.Put(PixelTypeFloat);
+            out.Put<uint32_t>(0); // pLinear and reserved
+            out.Put<int32_t>(1); // xSampling
+            out.Put<int32_t>(1); // ySampling
+        }
+        out.Put<char>(0);
+    });
+    out.PutAttribute("compression", "compression", [&]() { out.Put<uint8_t>(0); });
+    for (auto name : { "dataWindow", "displayWindow" }) {
+        out.PutAttribute(name, "box2i", [&]() {
+            out.Put<int32_t>(0);
+            out.Put<int32_t>(0);
+            out.Put<int32_t>((int32_t)width - 1);
+            out.Put<int32_t>((int32_t)height - 1);
+        });
+    }
+    out.PutAttribute("lineOrder", "lineOrder", [&]() { out.Put<uint8_t>(0); }); // Increasing y
+    out.PutAttribute("pixelAspectRatio", "float", [&]() { out.Put(1.0f); });
+    out.PutAttribute("screenWindowCenter", "v2f", [&]() {
+        out.Put(0.0f);
+        out.Put(0.0f);
+    });
+    out.PutAttribute("screenWindowWidth", "float", [&]() { out.Put(1.0f); });
+    out.Put<char>(0);
+
+    // One uncompressed scanline per chunk: y, byte count, then every channel of the line in turn.
+    const uint64_t chunkSize = 2 * sizeof(int32_t) + (uint64_t)width * std::size(Channels) * sizeof(float);
+    const uint64_t firstChunk = out.Size() + height * sizeof(uint64_t);
+    for (uint32_t y = 0; y < height; y++) {
+        out.Put<uint64_t>(firstChunk + y * chunkSize);
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        // EXR's y grows downwards, row 0 of ours is the bottom.
+        const glm::vec4* row = pixels + (size_t)(height - 1 - y) * width;
+
+        out.Put<int32_t>((int32_t)y);
+        out.Put<int32_t>((int32_t)(chunkSize - 2 * sizeof(int32_t)));
+        for (int channel : ChannelIndex) {
+            for (uint32_t x = 0; x < width; x++) {
+                out.Put(row[x][channel]);
+            }
+        }
+    }
+
+    return WriteFile(path, out.Bytes());
+}
+
+bool ImageIO::WriteHdr(const std::filesystem::path& path, uint32_t width, uint32_t height, const glm::vec4* pixels)
+{
+    std::string header = fmt::format("#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y {} +X {}\n", height, width);
+    std::vector<char> bytes(header.begin(), header.end());
+
+    bytes.reserve(bytes.size() + (size_t)width * height * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        // -Y: the first scanline is the top.
+        const glm::vec4* row = pixels + (size_t)(height - 1 - y) * width;
+
+        for (uint32_t x = 0; x < width; x++) {
+            glm::vec3 rgb = glm::max(glm::vec3(row[x]), 0.0f);
+            float maxComponent = std::max(rgb.r, std::max(rgb.g, rgb.b));
+
+            // Shared exponent, the mantissas are the components scaled to [0,256).
+            uint8_t rgbe[4] = {};
+            if (maxComponent >= 1e-32f) {
+                int exponent;
+                float scale = std::frexp(maxComponent, &exponent) * 256.0f / maxComponent;
+                rgbe[0] = (uint8_t)(rgb.r * scale);
+                rgbe[1] = (uint8_t)(rgb.g * scale);
+                rgbe[2] = (uint8_t)(rgb.b * scale);
+                rgbe[3] = (uint8_t)(exponent + 128);
+            }
+            bytes.insert(bytes.end(), rgbe, rgbe + 4);
+        }
+    }
+
+    return WriteFile(path, bytes);
+}
+
+bool ImageIO::IsHdrPath(const std::filesystem::path& path)
+{
+    auto ext = path.extension();
+    return ext == ".exr" || ext == ".hdr";
+}
+
+bool ImageIO::IsSupportedPath(const std::filesystem::path& path)
+{
+    auto ext = path.extension();
+    return ext == ".png" || ext == ".bmp" || ext == ".tga" || ext == ".jpg" || ext == ".jpeg" || IsHdrPath(path);
+}
+
+bool ImageIO::Write(const std::filesystem::path& path, uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+    // stb's settings are globals, set once so that writer threads never race on them.
+    [[maybe_unused]] static const bool configured = []() {
+        // Row 0 is the bottom of the image, the viewer flips it the same way.
+        stbi_flip_vertically_on_write(1);
+        // Least effort, stb's deflate is slow and images are mostly saved as snapshots.
+        stbi_write_png_compression_level = 1;
+        return true;
+    }();
+
+    auto w = (int)width, h = (int)height;
+    std::string file = path.string();
+    auto ext = path.extension();
+
+    bool written;
+    if (ext == ".png") {
+        written = stbi_write_png(file.c_str(), w, h, 4, pixels, w * 4);
+    } else if (ext == ".bmp") {
+        written = stbi_write_bmp(file.c_str(), w, h, 4, pixels);
+    } else if (ext == ".tga") {
+        written = stbi_write_tga(file.c_str(), w, h, 4, pixels);
+    } else if (ext == ".jpg" || ext == ".jpeg") {
+        written = stbi_write_jpg(file.c_str(), w, h, 4, pixels, 95);
+    } else {
+        fmt::println(stderr, "Error: unsupported image format '{}'", ext.string());
+        return false;
+    }
+
+    if (!written) {
+        fmt::println(stderr, "Error: could not write '{}'", file);
+    }
+    return written;
+}
+
+bool ImageIO::Write(const std::filesystem::path& path, uint32_t width, uint32_t height, const glm::vec4* pixels)
+{
+    if (path.extension() == ".exr") {
+        return WriteExr(path, width, height, pixels);
+    } else if (path.extension() == ".hdr") {
+        return WriteHdr(path, width, height, pixels);
+    }
+
+    fmt::println(stderr, "Error: unsupported HDR format '{}'", path.extension().string());
+    return false;
+}
@@ -0,0 +1,34 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Synchronous image writers, see @ref `ImageWriter` to write without blocking. Images have row 0
+ * at the bottom, as rendered. 8-bit images are `width * height` ABGR words, see @ref `Renderer::GetImage`,
+ * HDR images `width * height` linear RGBA floats, see @ref `Renderer::GetHdrImage`.
+ */
+namespace ImageIO {
+
+/// @brief OpenEXR, uncompressed 32-bit float RGBA scanlines. Errors are printed.
+bool WriteExr(const std::filesystem::path& path, uint32_t width, uint32_t height, const glm::vec4* pixels);
+
+/// @brief Radiance RGBE (`.hdr`), uncompressed. Alpha is dropped. Errors are printed.
+bool WriteHdr(const std::filesystem::path& path, uint32_t width, uint32_t height, const glm::vec4* pixels);
+
+/// @brief `.exr` and `.hdr`, written from linear radiance.
+bool IsHdrPath(const std::filesystem::path& path);
+/// @brief `.png`, `.bmp`, `.tga`, `.jpg` or an HDR path.
+bool IsSupportedPath(const std::filesystem::path& path);
+
+/// @brief Picks the writer by extension, `.png`, `.bmp`, `.tga` or `.jpg`. Errors are printed.
+bool Write(const std::filesystem::path& path, uint32_t width, uint32_t height, const uint32_t* pixels);
+/// @brief Picks the writer by extension, `.exr` or `.hdr`. Errors are printed.
+bool Write(const std::filesystem::path& path, uint32_t width, uint32_t height, const glm::vec4* pixels);
+
+} // namespace ImageIO
+
+#endif // IMAGE_IO_H
@@ -0,0 +1,28 @@
+#ifndef IMAGE_SINK_H
+#define IMAGE_SINK_H
+
+#include <cstdint>
+
+/**
+ * @brief Destination for the frames produced by @ref `Renderer`.
+ * Keeps the renderer free of any window or GPU dependency, e.g. the viewer uploads to a texture.
+ */
+class ImageSink {
+public:
+    virtual ~ImageSink() = default;
+
+    virtual void OnResize(uint32_t width, uint32_t height) = 0;
+
+    /// @brief `pixels` holds `width * height` ABGR words, only valid during the call.
+    virtual void SetData(const uint32_t* pixels) = 0;
+
+    /**
+     * @brief Optional zero-copy path. Returns a buffer for `width * height` ABGR words the renderer
+     * writes the frame into directly, followed by @ref `EndFrame` instead of @ref `SetData`.
+     * @return `nullptr` if the sink only supports @ref `SetData`.
+     */
+    virtual uint32_t* BeginFrame() { return nullptr; }
+    virtual void EndFrame() { }
+};
+
+#endif // IMAGE_SINK_H
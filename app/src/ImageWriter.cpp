@@ -0,0 +1,99 @@
+#include "ImageWriter.h"
+
+#include "Walnut/Profiler.h"
+
+#include <fmt/format.h>
+
+#include <utility> // move
+
+#include "ImageIO.h"
+#include "Renderer.h"
+
+ImageWriter::ImageWriter()
+{
+    m_Thread = std::thread([this]() { WorkerLoop(); });
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WakeCV.notify_one();
+    m_Thread.join();
+}
+
+bool ImageWriter::Submit(const std::filesystem::path& path, const Renderer& renderer)
+{
+    WL_PROFILE_SCOPE("ImageWriter::Submit");
+
+    if (!ImageIO::IsSupportedPath(path)) {
+        fmt::println(stderr, "Error: unsupported image format '{}'", path.extension().string());
+        return false;
+    }
+
+    Job job {
+        .Path = path,
+        .Width = renderer.GetWidth(),
+        .Height = renderer.GetHeight(),
+    };
+    if (ImageIO::IsHdrPath(path)) {
+        renderer.GetHdrImage(job.Radiance);
+    } else {
+        renderer.GetImage(job.Pixels);
+    }
+
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Jobs.push_back(std::move(job));
+    }
+    m_WakeCV.notify_one();
+    return true;
+}
+
+uint32_t ImageWriter::GetPendingCount() const
+{
+    std::lock_guard lock(m_Mutex);
+    return (uint32_t)m_Jobs.size() + (m_Writing ? 1 : 0);
+}
+
+bool ImageWriter::Flush()
+{
+    std::unique_lock lock(m_Mutex);
+    m_IdleCV.wait(lock, [this]() { return m_Jobs.empty() && !m_Writing; });
+    return !std::exchange(m_Failed, false);
+}
+
+void ImageWriter::WorkerLoop()
+{
+    Walnut::Profiler::SetThreadName("Image writer");
+
+    std::unique_lock lock(m_Mutex);
+    while (true) {
+        m_WakeCV.wait(lock, [this]() { return m_Stop || !m_Jobs.empty(); });
+        if (m_Jobs.empty()) {
+            return;
+        }
+
+        Job job = std::move(m_Jobs.front());
+        m_Jobs.pop_front();
+        m_Writing = true;
+        lock.unlock();
+
+        bool written;
+        {
+            WL_PROFILE_SCOPE("ImageWriter::Write");
+            written = job.Radiance.empty()
+                ? ImageIO::Write(job.Path, job.Width, job.Height, job.Pixels.data())
+                : ImageIO::Write(job.Path, job.Width, job.Height, job.Radiance.data());
+        }
+
+        lock.lock();
+        m_Writing = false;
+        m_Failed |= !written;
+        if (m_Jobs.empty()) {
+            m_IdleCV.notify_all();
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Renderer;
+
+/**
+ * @brief Encodes and writes images on a background thread, so saving never stalls the UI or the
+ * accumulation. The caller only pays for a snapshot of the renderer's image, the queue owns it.
+ */
+class ImageWriter {
+public:
+    ImageWriter();
+    /// @brief Writes the images still queued first.
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    /**
+     * @brief Snapshots the accumulated image of `renderer` and queues it, the format follows the
+     * extension, see @ref `ImageIO`. `.exr` and `.hdr` get the linear radiance, the rest the displayed image.
+     * @return `false` for unsupported extensions. Write errors are printed by the writer thread.
+     */
+    bool Submit(const std::filesystem::path& path, const Renderer& renderer);
+
+    /// @brief Images queued or being written, e.g. to skip an autosave while the last one is pending.
+    uint32_t GetPendingCount() const;
+
+    /// @brief Blocks until every queued image is written. `false` if any write failed since the last call.
+    bool Flush();
+
+private:
+    struct Job {
+        std::filesystem::path Path;
+        uint32_t Width = 0, Height = 0;
+        /// @brief One of them is filled, see `Submit`.
+        std::vector<uint32_t> Pixels;
+        std::vector<glm::vec4> Radiance;
+    };
+
+    void WorkerLoop();
+
+private:
+    std::thread m_Thread;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_WakeCV, m_IdleCV;
+    std::deque<Job> m_Jobs;
+    /// @brief The job being written, already popped from `m_Jobs`.
+    bool m_Writing = false;
+    bool m_Failed = false;
+    bool m_Stop = false;
+};
+
+#endif // IMAGE_WRITER_H
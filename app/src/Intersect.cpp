@@ -0,0 +1,322 @@
+#include "Intersect.h"
+
+#include <glm/glm.hpp>
+
+#include <utility> // swap
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RT_X86 1
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC emits any intrinsic without flags, GCC and Clang need the ISA enabled per function.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RT_TARGET(isa)
+#else
+#define RT_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+
+/// @brief Widest register is 8 floats, so every load of 8 starting at a valid slot stays in bounds.
+constexpr uint32_t SoAPadding = 7;
+
+void SpheresScalar(const SpheresSoA& spheres, const Ray& ray,
+    uint32_t first, uint32_t count, float& hitDist, int& hitIdx)
+{
+    // Same quadratic as before, with the 2s cancelled out:
+    // t = (-b - √(b^2 - ac)) / a, where b = dot(o, d) and c = dot(o, o) - r^2
+    float a = glm::dot(ray.Direction, ray.Direction);
+
+    for (uint32_t i = first; i < first + count; i++) {
+        glm::vec3 origin = ray.Origin - glm::vec3(spheres.PosX[i], spheres.PosY[i], spheres.PosZ[i]);
+
+        float b = glm::dot(origin, ray.Direction);
+        float c = glm::dot(origin, origin) - spheres.RadiusSq[i];
+        float discriminant = b * b - a * c;
+
+        if (discriminant < 0.0f) {
+            continue;
+        }
+
+        float t = (-b - glm::sqrt(discriminant)) / a;
+        if (t > 0.0f && t < hitDist) {
+            hitDist = t;
+            hitIdx = (int)i;
+        }
+    }
+}
+
+#ifdef RT_X86
+
+RT_TARGET("sse4.1")
+void SpheresSSE4(const SpheresSoA& spheres, const Ray& ray,
+    uint32_t first, uint32_t count, float& hitDist, int& hitIdx)
+{
+    const __m128 ox = _mm_set1_ps(ray.Origin.x), oy = _mm_set1_ps(ray.Origin.y), oz = _mm_set1_ps(ray.Origin.z);
+    const __m128 dx = _mm_set1_ps(ray.Direction.x), dy = _mm_set1_ps(ray.Direction.y), dz = _mm_set1_ps(ray.Direction.z);
+
+    float a = glm::dot(ray.Direction, ray.Direction);
+    const __m128 va = _mm_set1_ps(a), invA = _mm_set1_ps(1.0f / a);
+    const __m128 zero = _mm_setzero_ps();
+
+    const __m128i end = _mm_set1_epi32((int)(first + count));
+    __m128i lane = _mm_add_epi32(_mm_set1_epi32((int)first), _mm_setr_epi32(0, 1, 2, 3));
+
+    __m128 best = _mm_set1_ps(hitDist);
+    __m128i bestIdx = _mm_set1_epi32(-1);
+
+    for (uint32_t i = first; i < first + count; i += 4) {
+        __m128 ocx = _mm_sub_ps(ox, _mm_loadu_ps(&spheres.PosX[i]));
+        __m128 ocy = _mm_sub_ps(oy, _mm_loadu_ps(&spheres.PosY[i]));
+        __m128 ocz = _mm_sub_ps(oz, _mm_loadu_ps(&spheres.PosZ[i]));
+
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+        __m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz));
+        c = _mm_sub_ps(c, _mm_loadu_ps(&spheres.RadiusSq[i]));
+
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(va, c));
+        __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(discriminant)), invA);
+
+        // NaN from a negative discriminant fails every ordered compare.
+        __m128 mask = _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, best));
+        mask = _mm_and_ps(mask, _mm_castsi128_ps(_mm_cmpgt_epi32(end, lane)));
+
+        best = _mm_blendv_ps(best, t, mask);
+        bestIdx = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(bestIdx), _mm_castsi128_ps(lane), mask));
+
+        lane = _mm_add_epi32(lane, _mm_set1_epi32(4));
+    }
+
+    alignas(16) float dists[4];
+    alignas(16) int indices[4];
+    _mm_store_ps(dists, best);
+    _mm_store_si128((__m128i*)indices, bestIdx);
+
+    for (int l = 0; l < 4; l++) {
+        if (indices[l] >= 0 && dists[l] < hitDist) {
+            hitDist = dists[l];
+            hitIdx = indices[l];
+        }
+    }
+}
+
+RT_TARGET("avx2,fma")
+void SpheresAVX2(const SpheresSoA& spheres, const Ray& ray,
+    uint32_t first, uint32_t count, float& hitDist, int& hitIdx)
+{
+    const __m256 ox = _mm256_set1_ps(ray.Origin.x), oy = _mm256_set1_ps(ray.Origin.y), oz = _mm256_set1_ps(ray.Origin.z);
+    const __m256 dx = _mm256_set1_ps(ray.Direction.x), dy = _mm256_set1_ps(ray.Direction.y), dz = _mm256_set1_ps(ray.Direction.z);
+
+    float a = glm::dot(ray.Direction, ray.Direction);
+    const __m256 va = _mm256_set1_ps(a), invA = _mm256_set1_ps(1.0f / a);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256i end = _mm256_set1_epi32((int)(first + count));
+    __m256i lane = _mm256_add_epi32(_mm256_set1_epi32((int)first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    __m256 best = _mm256_set1_ps(hitDist);
+    __m256i bestIdx = _mm256_set1_epi32(-1);
+
+    for (uint32_t i = first; i < first + count; i += 8) {
+        __m256 ocx = _mm256_sub_ps(ox, _mm256_loadu_ps(&spheres.PosX[i]));
+        __m256 ocy = _mm256_sub_ps(oy, _mm256_loadu_ps(&spheres.PosY[i]));
+        __m256 ocz = _mm256_sub_ps(oz, _mm256_loadu_ps(&spheres.PosZ[i]));
+
+        __m256 b = _mm256_fmadd_ps(ocz, dz, _mm256_fmadd_ps(ocy, dy, _mm256_mul_ps(ocx, dx)));
+        __m256 c = _mm256_fmadd_ps(ocz, ocz, _mm256_fmadd_ps(ocy, ocy, _mm256_mul_ps(ocx, ocx)));
+        c = _mm256_sub_ps(c, _mm256_loadu_ps(&spheres.RadiusSq[i]));
+
+        __m256 discriminant = _mm256_fmsub_ps(b, b, _mm256_mul_ps(va, c));
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), _mm256_sqrt_ps(discriminant)), invA);
+
+        // NaN from a negative discriminant fails every ordered compare.
+        __m256 mask = _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GT_OQ), _mm256_cmp_ps(t, best, _CMP_LT_OQ));
+        mask = _mm256_and_ps(mask, _mm256_castsi256_ps(_mm256_cmpgt_epi32(end, lane)));
+
+        best = _mm256_blendv_ps(best, t, mask);
+        bestIdx = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIdx), _mm256_castsi256_ps(lane), mask));
+
+        lane = _mm256_add_epi32(lane, _mm256_set1_epi32(8));
+    }
+
+    alignas(32) float dists[8];
+    alignas(32) int indices[8];
+    _mm256_store_ps(dists, best);
+    _mm256_store_si256((__m256i*)indices, bestIdx);
+
+    for (int l = 0; l < 8; l++) {
+        if (indices[l] >= 0 && dists[l] < hitDist) {
+            hitDist = dists[l];
+            hitIdx = indices[l];
+        }
+    }
+}
+
+bool CpuSupportsAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27), avx = info[2] & (1 << 28), fma = info[2] & (1 << 12);
+    if (!osxsave || !avx || !fma) {
+        return false;
+    }
+
+    // OS must save the YMM registers on context switch.
+    if ((_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+bool CpuSupportsSSE4()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 19);
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#endif // RT_X86
+
+Intersect::SpheresKernel SelectSpheresKernel()
+{
+#ifdef RT_X86
+    if (CpuSupportsAVX2()) {
+        return { SpheresAVX2, "AVX2", 8 };
+    }
+    if (CpuSupportsSSE4()) {
+        return { SpheresSSE4, "SSE4.1", 4 };
+    }
+#endif
+    return { SpheresScalar, "Scalar", 1 };
+}
+
+} // namespace
+
+void SpheresSoA::Build(const std::vector<Sphere>& spheres, std::span<const uint32_t> order)
+{
+    size_t len = order.size() + SoAPadding;
+
+    PosX.resize(len);
+    PosY.resize(len);
+    PosZ.resize(len);
+    RadiusSq.resize(len);
+
+    for (size_t i = 0; i < order.size(); i++) {
+        auto& sphere = spheres[order[i]];
+        PosX[i] = sphere.Pos.x;
+        PosY[i] = sphere.Pos.y;
+        PosZ[i] = sphere.Pos.z;
+        RadiusSq[i] = sphere.Radius * sphere.Radius;
+    }
+
+    // Padding lanes are masked out by the kernels, but keep them finite and far away.
+    for (size_t i = order.size(); i < len; i++) {
+        PosX[i] = PosY[i] = PosZ[i] = 1e30f;
+        RadiusSq[i] = 0.0f;
+    }
+}
+
+void TrianglesSoA::Build(const MeshGeometry& geometry, std::span<const uint32_t> order)
+{
+    V0.resize(order.size());
+    V1.resize(order.size());
+    V2.resize(order.size());
+    TriIndices.assign(order.begin(), order.end());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const uint32_t* idx = &geometry.Indices[order[i] * 3];
+
+        V0[i] = geometry.Positions[idx[0]];
+        V1[i] = geometry.Positions[idx[1]];
+        V2[i] = geometry.Positions[idx[2]];
+    }
+}
+
+Intersect::WatertightRay::WatertightRay(const Ray& ray)
+    : Origin(ray.Origin)
+{
+    glm::vec3 absDir = glm::abs(ray.Direction);
+
+    Kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+    Kx = (Kz + 1) % 3;
+    Ky = (Kx + 1) % 3;
+
+    // Keep the winding of the projected triangle independent of the direction's sign.
+    if (ray.Direction[Kz] < 0.0f) {
+        std::swap(Kx, Ky);
+    }
+
+    Sx = ray.Direction[Kx] / ray.Direction[Kz];
+    Sy = ray.Direction[Ky] / ray.Direction[Kz];
+    Sz = 1.0f / ray.Direction[Kz];
+}
+
+void Intersect::Triangles(const TrianglesSoA& triangles, const WatertightRay& ray,
+    uint32_t first, uint32_t count, float& hitDist, int& hitIdx, glm::vec2& barycentric)
+{
+    for (uint32_t i = first; i < first + count; i++) {
+        // Vertices relative to the origin, sheared so the ray runs along +z through (0, 0).
+        glm::vec3 a = triangles.V0[i] - ray.Origin;
+        glm::vec3 b = triangles.V1[i] - ray.Origin;
+        glm::vec3 c = triangles.V2[i] - ray.Origin;
+
+        float ax = a[ray.Kx] - ray.Sx * a[ray.Kz], ay = a[ray.Ky] - ray.Sy * a[ray.Kz];
+        float bx = b[ray.Kx] - ray.Sx * b[ray.Kz], by = b[ray.Ky] - ray.Sy * b[ray.Kz];
+        float cx = c[ray.Kx] - ray.Sx * c[ray.Kz], cy = c[ray.Ky] - ray.Sy * c[ray.Kz];
+
+        // Scaled barycentrics, the edge functions of the projected triangle.
+        float u = cx * by - cy * bx;
+        float v = ax * cy - ay * cx;
+        float w = bx * ay - by * ax;
+
+        // On an edge, float rounding may decide differently for the two neighbours. Redo in double.
+        if (u == 0.0f || v == 0.0f || w == 0.0f) {
+            u = (float)((double)cx * by - (double)cy * bx);
+            v = (float)((double)ax * cy - (double)ay * cx);
+            w = (float)((double)bx * ay - (double)by * ax);
+        }
+
+        if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f)) {
+            continue;
+        }
+
+        float det = u + v + w;
+        if (det == 0.0f) {
+            continue;
+        }
+
+        float t = u * ray.Sz * a[ray.Kz] + v * ray.Sz * b[ray.Kz] + w * ray.Sz * c[ray.Kz];
+
+        // Distance test on the unnormalized `t`, the division is only paid for actual hits.
+        bool inRange = det > 0.0f ? (t > 0.0f && t < hitDist * det) : (t < 0.0f && t > hitDist * det);
+        if (!inRange) {
+            continue;
+        }
+
+        float invDet = 1.0f / det;
+        hitDist = t * invDet;
+        hitIdx = (int)i;
+        barycentric = { v * invDet, w * invDet };
+    }
+}
+
+const Intersect::SpheresKernel& Intersect::GetSpheresKernel()
+{
+    static const SpheresKernel kernel = SelectSpheresKernel();
+    return kernel;
+}
@@ -0,0 +1,79 @@
+#ifndef INTERSECT_H
+#define INTERSECT_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Ray.h"
+#include "Scene.h"
+
+/**
+ * @brief Structure of arrays mirror of `Scene::Spheres`, stored in BVH leaf order so a leaf is a
+ * contiguous range. Arrays are padded, so a kernel may always load a full register from any index.
+ */
+struct SpheresSoA {
+    std::vector<float> PosX, PosY, PosZ, RadiusSq;
+
+    /// @param order Sphere index for every SoA slot, usually @ref `BVH::GetPrimIndices`.
+    void Build(const std::vector<Sphere>& spheres, std::span<const uint32_t> order);
+};
+
+/**
+ * @brief Vertices of every triangle of a geometry, in object space, copied out in BVH leaf order so a
+ * leaf is a contiguous range and the kernel does not chase index buffers.
+ */
+struct TrianglesSoA {
+    std::vector<glm::vec3> V0, V1, V2;
+    /// @brief Triangle in the geometry of every slot.
+    std::vector<uint32_t> TriIndices;
+
+    /// @param order Triangle index for every slot, usually @ref `BVH::GetPrimIndices`.
+    void Build(const MeshGeometry& geometry, std::span<const uint32_t> order);
+};
+
+namespace Intersect {
+
+/**
+ * @brief Closest sphere in `[first, first + count)` of `spheres` closer than `hitDist`.
+ * On a hit `hitDist` is shrunk and `hitIdx` is set to the SoA slot.
+ */
+using SpheresFn = void (*)(const SpheresSoA& spheres, const Ray& ray,
+    uint32_t first, uint32_t count, float& hitDist, int& hitIdx);
+
+struct SpheresKernel {
+    SpheresFn Fn;
+    const char* Name;
+    /// @brief Spheres tested per instruction. BVH leaves smaller than this waste lanes.
+    uint32_t Lanes;
+};
+
+/// @brief Widest kernel the CPU supports: AVX2, SSE4.1 or scalar. Detected once.
+const SpheresKernel& GetSpheresKernel();
+
+/**
+ * @brief Ray prepared for the watertight triangle test (Woop, Benthin, Wald 2013): the axis the
+ * direction is largest along, and the shear that maps the direction onto it.
+ */
+struct WatertightRay {
+    glm::vec3 Origin;
+    int Kx, Ky, Kz;
+    float Sx, Sy, Sz;
+
+    explicit WatertightRay(const Ray& ray);
+};
+
+/**
+ * @brief Closest triangle in `[first, first + count)` of `triangles` closer than `hitDist`.
+ * Watertight: rays through shared edges or vertices never slip between neighbouring triangles.
+ * On a hit `hitDist` is shrunk, `hitIdx` is set to the slot and `barycentric` to the weights of
+ * `V1` and `V2`.
+ */
+void Triangles(const TrianglesSoA& triangles, const WatertightRay& ray,
+    uint32_t first, uint32_t count, float& hitDist, int& hitIdx, glm::vec2& barycentric);
+
+} // namespace Intersect
+
+#endif // INTERSECT_H
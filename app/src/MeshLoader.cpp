@@ -0,0 +1,666 @@
+#include "MeshLoader.h"
+
+#include <fmt/format.h>
+
+#include <algorithm> // reverse
+#include <bit> // endian
+#include <cctype> // tolower
+#include <charconv>
+#include <cmath> // floor, isfinite
+#include <cstring> // memchr, memcpy, memmove
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// @brief Reads a file in large blocks and hands out lines and records straight from the block.
+class BlockReader {
+public:
+    explicit BlockReader(const std::filesystem::path& path)
+        : m_File(path, std::ios::binary)
+        , m_Buffer(BlockSize)
+    {
+        std::error_code error;
+        m_FileSize = std::filesystem::file_size(path, error);
+        if (error) {
+            m_FileSize = 0;
+        }
+    }
+
+    bool IsOpen() const { return m_File.is_open(); }
+
+    /// @brief Next line without its `\n` or `\r\n`. The view is valid until the next call.
+    bool NextLine(std::string_view& line)
+    {
+        auto findNewline = [this] { return (const char*)std::memchr(m_Buffer.data() + m_Begin, '\n', m_End - m_Begin); };
+
+        const char* newline = findNewline();
+        while (!newline && Refill()) {
+            newline = findNewline();
+        }
+
+        // Only after the last `Refill`, even a failed one moves the unread bytes and may reallocate.
+        const char* begin = m_Buffer.data() + m_Begin;
+
+        // Without a newline, this is the last line of the file.
+        size_t len = newline ? (size_t)(newline - begin) : m_End - m_Begin;
+        if (!newline && len == 0) {
+            return false;
+        }
+
+        m_Begin += newline ? len + 1 : len;
+        line = { begin, len > 0 && begin[len - 1] == '\r' ? len - 1 : len };
+        return true;
+    }
+
+    /// @brief Bytes not handed out yet, to check counts read from a header before trusting them.
+    uint64_t GetRemaining() const
+    {
+        uint64_t unread = m_FileSize > m_FileRead ? m_FileSize - m_FileRead : 0;
+        return unread + (m_End - m_Begin);
+    }
+
+    /// @brief Copies the next `size` bytes to `dst`. False if the file ends first.
+    bool Read(void* dst, size_t size)
+    {
+        while (m_End - m_Begin < size) {
+            if (!Refill()) {
+                return false;
+            }
+        }
+
+        std::memcpy(dst, m_Buffer.data() + m_Begin, size);
+        m_Begin += size;
+        return true;
+    }
+
+private:
+    /// @brief Moves the unread tail to the front and appends the next block after it.
+    bool Refill()
+    {
+        if (!m_File) {
+            return false;
+        }
+
+        size_t tail = m_End - m_Begin;
+        std::memmove(m_Buffer.data(), m_Buffer.data() + m_Begin, tail);
+        m_Begin = 0;
+        m_End = tail;
+
+        // A line longer than a block grows the buffer instead of being cut.
+        if (m_Buffer.size() - tail < BlockSize) {
+            m_Buffer.resize(tail + BlockSize);
+        }
+
+        m_File.read(m_Buffer.data() + tail, (std::streamsize)(m_Buffer.size() - tail));
+        auto read = (size_t)m_File.gcount();
+
+        m_FileRead += read;
+        m_End += read;
+        return read > 0;
+    }
+
+private:
+    static constexpr size_t BlockSize = 1 << 20;
+
+    std::ifstream m_File;
+    std::vector<char> m_Buffer;
+    size_t m_Begin = 0, m_End = 0;
+    uint64_t m_FileSize = 0, m_FileRead = 0;
+};
+
+void SkipSpaces(const char*& p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+}
+
+/// @brief Next whitespace separated token of `line`, empty at its end.
+std::string_view NextToken(const char*& p, const char* end)
+{
+    SkipSpaces(p, end);
+
+    const char* begin = p;
+    while (p < end && *p != ' ' && *p != '\t') {
+        p++;
+    }
+
+    return { begin, (size_t)(p - begin) };
+}
+
+template <typename T>
+bool ParseNumber(const char*& p, const char* end, T& value)
+{
+    SkipSpaces(p, end);
+
+    // `from_chars` rejects an explicit plus sign, some exporters write one.
+    if (p < end && *p == '+') {
+        p++;
+    }
+
+    auto [ptr, err] = std::from_chars(p, end, value);
+    if (err != std::errc()) {
+        return false;
+    }
+
+    p = ptr;
+    return true;
+}
+
+void PrintError(const std::filesystem::path& path, size_t lineNo, std::string_view message)
+{
+    fmt::println(stderr, "Error: {}:{}: {}", path.string(), lineNo, message);
+}
+
+// OBJ
+
+/// @brief Face corner of an OBJ, its position and normal index.
+struct ObjCorner {
+    uint32_t Pos, Normal;
+};
+
+constexpr uint32_t NoNormal = UINT32_MAX;
+
+/// @brief OBJ indices are 1-based, negative ones count back from the last element read so far.
+bool ResolveObjIndex(int64_t idx, size_t count, uint32_t& resolved)
+{
+    idx = idx < 0 ? idx + (int64_t)count : idx - 1;
+    if (idx < 0 || idx >= (int64_t)count) {
+        return false;
+    }
+
+    resolved = (uint32_t)idx;
+    return true;
+}
+
+/// @brief Parses `v`, `v/vt`, `v//vn` or `v/vt/vn`. Texture coordinates are ignored.
+bool ParseObjCorner(const char*& p, const char* end, size_t posCount, size_t normalCount, ObjCorner& corner)
+{
+    int64_t posIdx = 0, texIdx = 0, normalIdx = 0;
+
+    if (!ParseNumber(p, end, posIdx) || !ResolveObjIndex(posIdx, posCount, corner.Pos)) {
+        return false;
+    }
+
+    corner.Normal = NoNormal;
+    if (p == end || *p != '/') {
+        return true;
+    }
+
+    p++;
+    if (p < end && *p != '/' && !ParseNumber(p, end, texIdx)) {
+        return false;
+    }
+
+    if (p == end || *p != '/') {
+        return true;
+    }
+
+    p++;
+    return ParseNumber(p, end, normalIdx) && ResolveObjIndex(normalIdx, normalCount, corner.Normal);
+}
+
+// PLY
+
+enum class PlyType : uint8_t {
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64,
+};
+
+bool ParsePlyType(std::string_view name, PlyType& type)
+{
+    // clang-format off
+    static const std::pair<std::string_view, PlyType> names[] = {
+        { "char", PlyType::Int8 },     { "int8", PlyType::Int8 },
+        { "uchar", PlyType::UInt8 },   { "uint8", PlyType::UInt8 },
+        { "short", PlyType::Int16 },   { "int16", PlyType::Int16 },
+        { "ushort", PlyType::UInt16 }, { "uint16", PlyType::UInt16 },
+        { "int", PlyType::Int32 },     { "int32", PlyType::Int32 },
+        { "uint", PlyType::UInt32 },   { "uint32", PlyType::UInt32 },
+        { "float", PlyType::Float32 }, { "float32", PlyType::Float32 },
+        { "double", PlyType::Float64 }, { "float64", PlyType::Float64 },
+    };
+    // clang-format on
+
+    for (auto& [typeName, value] : names) {
+        if (name == typeName) {
+            type = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t PlyTypeSize(PlyType type)
+{
+    switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+/// @brief Decodes one value from the raw bytes of a record.
+double DecodePlyValue(const char* src, PlyType type, bool swapBytes)
+{
+    char bytes[8];
+    uint32_t size = PlyTypeSize(type);
+
+    std::memcpy(bytes, src, size);
+    if (swapBytes) {
+        std::reverse(bytes, bytes + size);
+    }
+
+    auto as = [&bytes]<typename T>(T value) {
+        std::memcpy(&value, bytes, sizeof(T));
+        return (double)value;
+    };
+
+    switch (type) {
+    case PlyType::Int8:
+        return as(int8_t {});
+    case PlyType::UInt8:
+        return as(uint8_t {});
+    case PlyType::Int16:
+        return as(int16_t {});
+    case PlyType::UInt16:
+        return as(uint16_t {});
+    case PlyType::Int32:
+        return as(int32_t {});
+    case PlyType::UInt32:
+        return as(uint32_t {});
+    case PlyType::Float32:
+        return as(float {});
+    case PlyType::Float64:
+        return as(double {});
+    }
+    return 0.0;
+}
+
+struct PlyProperty {
+    std::string Name;
+    PlyType Type = PlyType::Float32;
+    bool IsList = false;
+    PlyType CountType = PlyType::UInt8;
+};
+
+struct PlyElement {
+    std::string Name;
+    uint64_t Count = 0;
+    std::vector<PlyProperty> Properties;
+};
+
+/// @brief Reads one value of `type` from the stream.
+/// @brief `glm::normalize`, but zero instead of NaN for vectors of zero or non-finite length.
+glm::vec3 NormalizeOrZero(const glm::vec3& v)
+{
+    float len = glm::length(v);
+    return len > 0.0f && std::isfinite(len) ? v / len : glm::vec3(0.0f);
+}
+
+/**
+ * @brief Gives vertices whose normal was zero the area weighted normal of their faces. Drops all
+ * normals, shading flat, if one is still zero after that, interpolating it could give NaN.
+ */
+void RepairNormals(MeshGeometry& mesh)
+{
+    auto isZero = [](const glm::vec3& n) { return n == glm::vec3(0.0f); };
+    if (std::none_of(std::begin(mesh.Normals), std::end(mesh.Normals), isZero)) {
+        return;
+    }
+
+    std::vector<glm::vec3> faceNormals(mesh.Positions.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+        const uint32_t* idx = &mesh.Indices[i];
+        glm::vec3 n = glm::cross(mesh.Positions[idx[1]] - mesh.Positions[idx[0]], mesh.Positions[idx[2]] - mesh.Positions[idx[0]]);
+        for (int c = 0; c < 3; c++) {
+            faceNormals[idx[c]] += n;
+        }
+    }
+
+    for (size_t v = 0; v < mesh.Normals.size(); v++) {
+        if (isZero(mesh.Normals[v])) {
+            mesh.Normals[v] = NormalizeOrZero(faceNormals[v]);
+        }
+    }
+
+    if (std::any_of(std::begin(mesh.Normals), std::end(mesh.Normals), isZero)) {
+        mesh.Normals.clear();
+    }
+}
+
+bool ReadPlyValue(BlockReader& reader, PlyType type, bool swapBytes, double& value)
+{
+    char bytes[8];
+    if (!reader.Read(bytes, PlyTypeSize(type))) {
+        return false;
+    }
+
+    value = DecodePlyValue(bytes, type, swapBytes);
+    return true;
+}
+
+} // namespace
+
+std::optional<MeshGeometry> MeshLoader::Load(const std::filesystem::path& path)
+{
+    auto ext = path.extension().string();
+    std::transform(std::begin(ext), std::end(ext), std::begin(ext), [](char c) { return (char)std::tolower(c); });
+
+    if (ext == ".obj") {
+        return LoadObj(path);
+    }
+    if (ext == ".ply") {
+        return LoadPly(path);
+    }
+
+    fmt::println(stderr, "Error: unsupported mesh format '{}'", ext);
+    return std::nullopt;
+}
+
+std::optional<MeshGeometry> MeshLoader::LoadObj(const std::filesystem::path& path)
+{
+    BlockReader reader(path);
+    if (!reader.IsOpen()) {
+        fmt::println(stderr, "Error: could not open '{}'", path.string());
+        return std::nullopt;
+    }
+
+    std::vector<glm::vec3> positions, normals;
+    std::vector<ObjCorner> corners, face;
+    bool missingNormals = false;
+
+    std::string_view line;
+    for (size_t lineNo = 1; reader.NextLine(line); lineNo++) {
+        const char* p = line.data();
+        const char* end = p + line.size();
+
+        auto keyword = NextToken(p, end);
+
+        if (keyword == "v" || keyword == "vn") {
+            glm::vec3 v;
+            if (!ParseNumber(p, end, v.x) || !ParseNumber(p, end, v.y) || !ParseNumber(p, end, v.z)) {
+                PrintError(path, lineNo, "expected three numbers");
+                return std::nullopt;
+            }
+
+            (keyword == "v" ? positions : normals).push_back(v);
+        } else if (keyword == "f") {
+            face.clear();
+
+            for (SkipSpaces(p, end); p < end; SkipSpaces(p, end)) {
+                ObjCorner corner;
+                if (!ParseObjCorner(p, end, positions.size(), normals.size(), corner)) {
+                    PrintError(path, lineNo, "invalid face index");
+                    return std::nullopt;
+                }
+
+                missingNormals |= corner.Normal == NoNormal;
+                face.push_back(corner);
+            }
+
+            if (face.size() < 3) {
+                PrintError(path, lineNo, "face with fewer than three vertices");
+                return std::nullopt;
+            }
+
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                corners.insert(std::end(corners), { face[0], face[i], face[i + 1] });
+            }
+        }
+        // Texture coordinates, groups, materials and comments are skipped.
+    }
+
+    MeshGeometry mesh;
+
+    // Without a normal for every corner, shade flat and index the positions directly.
+    if (normals.empty() || missingNormals) {
+        mesh.Positions = std::move(positions);
+        mesh.Indices.reserve(corners.size());
+
+        for (auto& corner : corners) {
+            mesh.Indices.push_back(corner.Pos);
+        }
+        return mesh;
+    }
+
+    // OBJ indexes positions and normals separately, make a vertex of every distinct pair.
+    std::unordered_map<uint64_t, uint32_t> vertexIds;
+    vertexIds.reserve(positions.size());
+    mesh.Indices.reserve(corners.size());
+
+    for (auto& corner : corners) {
+        uint64_t key = ((uint64_t)corner.Pos << 32) | corner.Normal;
+        auto [it, inserted] = vertexIds.try_emplace(key, (uint32_t)mesh.Positions.size());
+
+        if (inserted) {
+            mesh.Positions.push_back(positions[corner.Pos]);
+            mesh.Normals.push_back(NormalizeOrZero(normals[corner.Normal]));
+        }
+        mesh.Indices.push_back(it->second);
+    }
+
+    RepairNormals(mesh);
+    return mesh;
+}
+
+std::optional<MeshGeometry> MeshLoader::LoadPly(const std::filesystem::path& path)
+{
+    BlockReader reader(path);
+    if (!reader.IsOpen()) {
+        fmt::println(stderr, "Error: could not open '{}'", path.string());
+        return std::nullopt;
+    }
+
+    std::vector<PlyElement> elements;
+    bool littleEndian = true;
+
+    std::string_view line;
+    size_t lineNo = 1;
+
+    if (!reader.NextLine(line) || line != "ply") {
+        PrintError(path, lineNo, "not a PLY file");
+        return std::nullopt;
+    }
+
+    while (true) {
+        lineNo++;
+        if (!reader.NextLine(line)) {
+            PrintError(path, lineNo, "missing end_header");
+            return std::nullopt;
+        }
+
+        const char* p = line.data();
+        const char* end = p + line.size();
+        auto keyword = NextToken(p, end);
+
+        if (keyword == "end_header") {
+            break;
+        }
+
+        if (keyword == "format") {
+            auto format = NextToken(p, end);
+            if (format != "binary_little_endian" && format != "binary_big_endian") {
+                PrintError(path, lineNo, "only binary PLY is supported");
+                return std::nullopt;
+            }
+            littleEndian = format == "binary_little_endian";
+        } else if (keyword == "element") {
+            PlyElement element;
+            element.Name = NextToken(p, end);
+            if (!ParseNumber(p, end, element.Count)) {
+                PrintError(path, lineNo, "invalid element count");
+                return std::nullopt;
+            }
+            elements.push_back(std::move(element));
+        } else if (keyword == "property") {
+            if (elements.empty()) {
+                PrintError(path, lineNo, "property before any element");
+                return std::nullopt;
+            }
+
+            PlyProperty property;
+            auto type = NextToken(p, end);
+            bool ok = true;
+
+            if (type == "list") {
+                property.IsList = true;
+                ok = ParsePlyType(NextToken(p, end), property.CountType);
+                type = NextToken(p, end);
+            }
+
+            ok = ok && ParsePlyType(type, property.Type);
+            property.Name = NextToken(p, end);
+
+            if (!ok || property.Name.empty()) {
+                PrintError(path, lineNo, "invalid property");
+                return std::nullopt;
+            }
+            elements.back().Properties.push_back(std::move(property));
+        }
+        // `comment` and `obj_info` are skipped.
+    }
+
+    const bool swapBytes = littleEndian != (std::endian::native == std::endian::little);
+
+    MeshGeometry mesh;
+    std::vector<uint32_t> polygon;
+    std::vector<char> record;
+
+    for (auto& element : elements) {
+        bool isVertex = element.Name == "vertex", isFace = element.Name == "face";
+
+        // The count comes from the header, check it against the file before allocating or looping.
+        uint64_t minRecordSize = 0;
+        for (auto& property : element.Properties) {
+            minRecordSize += PlyTypeSize(property.IsList ? property.CountType : property.Type);
+        }
+        if (element.Count > 0 && (minRecordSize == 0 || element.Count > reader.GetRemaining() / minRecordSize)) {
+            fmt::println(stderr, "Error: {}: {} '{}' records do not fit in the file", path.string(), element.Count, element.Name);
+            return std::nullopt;
+        }
+        if (isVertex && element.Count > std::numeric_limits<uint32_t>::max()) {
+            fmt::println(stderr, "Error: {}: too many vertices", path.string());
+            return std::nullopt;
+        }
+
+        // Scalar-only records are read in one go and decoded at fixed offsets.
+        bool fixedSize = std::none_of(std::begin(element.Properties), std::end(element.Properties),
+            [](const PlyProperty& property) { return property.IsList; });
+
+        if (fixedSize) {
+            // Offset of each property, and where x y z nx ny nz are, if present.
+            std::vector<uint32_t> offsets;
+            uint32_t stride = 0;
+            int xyz[3] = { -1, -1, -1 }, normal[3] = { -1, -1, -1 };
+
+            for (int i = 0; auto& property : element.Properties) {
+                offsets.push_back(stride);
+                stride += PlyTypeSize(property.Type);
+
+                const char* names[] = { "x", "y", "z", "nx", "ny", "nz" };
+                for (int c = 0; c < 6; c++) {
+                    if (property.Name == names[c]) {
+                        (c < 3 ? xyz[c] : normal[c - 3]) = i;
+                    }
+                }
+                i++;
+            }
+
+            if (isVertex && (xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0)) {
+                fmt::println(stderr, "Error: {}: vertices without x, y and z", path.string());
+                return std::nullopt;
+            }
+
+            bool hasNormals = isVertex && normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+            if (isVertex) {
+                mesh.Positions.resize(element.Count);
+                mesh.Normals.resize(hasNormals ? element.Count : 0);
+            }
+
+            record.resize(stride);
+            for (uint64_t r = 0; r < element.Count; r++) {
+                if (!reader.Read(record.data(), stride)) {
+                    fmt::println(stderr, "Error: {}: unexpected end of file in '{}'", path.string(), element.Name);
+                    return std::nullopt;
+                }
+
+                if (!isVertex) {
+                    continue;
+                }
+
+                auto decode = [&](int propIdx) {
+                    return (float)DecodePlyValue(&record[offsets[propIdx]], element.Properties[propIdx].Type, swapBytes);
+                };
+
+                mesh.Positions[r] = { decode(xyz[0]), decode(xyz[1]), decode(xyz[2]) };
+                if (hasNormals) {
+                    mesh.Normals[r] = NormalizeOrZero(glm::vec3(decode(normal[0]), decode(normal[1]), decode(normal[2])));
+                }
+            }
+            continue;
+        }
+
+        for (uint64_t r = 0; r < element.Count; r++) {
+            for (auto& property : element.Properties) {
+                bool isIndices = isFace && (property.Name == "vertex_indices" || property.Name == "vertex_index");
+                double value = 0.0, count = 1.0;
+
+                if (property.IsList && !ReadPlyValue(reader, property.CountType, swapBytes, count)) {
+                    fmt::println(stderr, "Error: {}: unexpected end of file in '{}'", path.string(), element.Name);
+                    return std::nullopt;
+                }
+
+                // Negative, fractional or NaN lengths cannot be converted, longer ones cannot be read.
+                if (!(count >= 0.0 && count == std::floor(count) && count * PlyTypeSize(property.Type) <= (double)reader.GetRemaining())) {
+                    fmt::println(stderr, "Error: {}: '{}' {} has an invalid list length", path.string(), element.Name, r);
+                    return std::nullopt;
+                }
+
+                polygon.clear();
+                for (uint32_t i = 0; i < (uint32_t)count; i++) {
+                    if (!ReadPlyValue(reader, property.Type, swapBytes, value)) {
+                        fmt::println(stderr, "Error: {}: unexpected end of file in '{}'", path.string(), element.Name);
+                        return std::nullopt;
+                    }
+
+                    if (isIndices) {
+                        if (!(value >= 0.0 && value < (double)mesh.Positions.size())) {
+                            fmt::println(stderr, "Error: {}: face {} references a missing vertex", path.string(), r);
+                            return std::nullopt;
+                        }
+                        polygon.push_back((uint32_t)value);
+                    }
+                }
+
+                for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                    mesh.Indices.insert(std::end(mesh.Indices), { polygon[0], polygon[i], polygon[i + 1] });
+                }
+            }
+        }
+    }
+
+    RepairNormals(mesh);
+    return mesh;
+}
@@ -0,0 +1,27 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <filesystem>
+#include <optional>
+
+#include "Scene.h"
+
+/**
+ * @brief Streaming mesh readers. Files are read in large blocks and parsed in place, lines and
+ * records are never copied into strings, so multi-million triangle files load at disk speed.
+ * Polygons are fan triangulated. Errors are printed to `stderr` and return `std::nullopt`.
+ */
+namespace MeshLoader {
+
+/// @brief Picks the reader by extension, `.obj` or `.ply`.
+std::optional<MeshGeometry> Load(const std::filesystem::path& path);
+
+/// @brief Wavefront OBJ: `v`, `vn` and `f` in any of its index forms, negative indices included.
+std::optional<MeshGeometry> LoadObj(const std::filesystem::path& path);
+
+/// @brief Binary PLY, either endianness: `vertex` with `x y z` and optional `nx ny nz`, `face` lists.
+std::optional<MeshGeometry> LoadPly(const std::filesystem::path& path);
+
+} // namespace MeshLoader
+
+#endif // MESH_LOADER_H
@@ -0,0 +1,61 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief `RT_STAT(stats.Field += n)` counts only in builds with `RT_STATS` defined, see the
+ * `RT_STATS` CMake option. Release builds compile the counters out entirely.
+ */
+#ifdef RT_STATS
+#define RT_STAT(expr) expr
+#else
+#define RT_STAT(expr)
+#endif
+
+/// @brief Work done by @ref `Renderer::Render` for one frame, summed over all render threads.
+struct RenderStats {
+#ifdef RT_STATS
+    static constexpr bool Enabled = true;
+#else
+    static constexpr bool Enabled = false;
+#endif
+
+    /// @brief Path lengths in bounces, the last bin counts every longer path.
+    static constexpr uint32_t PathLengthBins = 16;
+
+    uint64_t PrimaryRays = 0;
+    uint64_t SecondaryRays = 0;
+    /// @brief Ray-primitive tests in BVH leaves.
+    uint64_t SphereTests = 0;
+    uint64_t TriangleTests = 0;
+    uint64_t Hits = 0;
+    std::array<uint64_t, PathLengthBins> PathLengths {};
+
+    /// @brief Pixels sampled this frame, fewer than the image once adaptive tiles converge.
+    uint64_t Samples = 0;
+    /// @brief Mean samples accumulated per pixel so far.
+    float SamplesPerPixel = 0.0f;
+    /// @brief Wall-clock time of the frame.
+    float FrameSeconds = 0.0f;
+
+    uint64_t GetRays() const { return PrimaryRays + SecondaryRays; }
+    double GetRaysPerSecond() const { return FrameSeconds > 0.0f ? (double)GetRays() / FrameSeconds : 0.0; }
+
+    RenderStats& operator+=(const RenderStats& other)
+    {
+        PrimaryRays += other.PrimaryRays;
+        SecondaryRays += other.SecondaryRays;
+        SphereTests += other.SphereTests;
+        TriangleTests += other.TriangleTests;
+        Hits += other.Hits;
+        for (uint32_t i = 0; i < PathLengthBins; i++) {
+            PathLengths[i] += other.PathLengths[i];
+        }
+        Samples += other.Samples;
+        return *this;
+    }
+};
+
+#endif // RENDER_STATS_H
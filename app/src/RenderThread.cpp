@@ -0,0 +1,162 @@
+#include "RenderThread.h"
+
+#include "Walnut/Profiler.h"
+#include "Walnut/Timer.h"
+
+#include <utility> // move, swap
+
+RenderThread::RenderThread()
+    : m_Sink(std::make_shared<FrameSink>(m_Frames))
+{
+    m_Renderer.SetSink(m_Sink);
+    m_Thread = std::thread([this]() { ThreadLoop(); });
+}
+
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WakeCV.notify_one();
+    m_Thread.join();
+}
+
+void RenderThread::Submit(const Input& input)
+{
+    m_Inputs.GetBack() = input;
+    m_Inputs.Publish();
+
+    {
+        std::lock_guard lock(m_Mutex);
+        m_SubmitCount++;
+    }
+    m_WakeCV.notify_one();
+}
+
+void RenderThread::Post(std::function<void(Renderer&)> task)
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+    }
+    m_WakeCV.notify_one();
+}
+
+void RenderThread::FrameSink::OnResize(uint32_t width, uint32_t height)
+{
+    m_Width = width;
+    m_Height = height;
+}
+
+uint32_t* RenderThread::FrameSink::BeginFrame()
+{
+    Frame& frame = m_Frames.GetBack();
+    frame.Width = m_Width;
+    frame.Height = m_Height;
+    frame.Pixels.resize((size_t)m_Width * m_Height);
+    return frame.Pixels.data();
+}
+
+void RenderThread::ThreadLoop()
+{
+    Walnut::Profiler::SetThreadName("Render");
+
+    // Adaptive sampling found nothing left to sample, until the next change.
+    bool converged = false;
+
+    while (true) {
+        uint32_t seenSubmits;
+        {
+            std::lock_guard lock(m_Mutex);
+            seenSubmits = m_SubmitCount;
+            if (m_Stop) {
+                break;
+            }
+        }
+
+        converged &= !ApplyInput();
+        RunTasks();
+
+        const Input& input = m_Applied;
+        if (input.Paused || !input.SceneSnapshot || !input.Width || !input.Height || converged) {
+            std::unique_lock lock(m_Mutex);
+            m_WakeCV.wait(lock, [&]() { return m_Stop || !m_Tasks.empty() || m_SubmitCount != seenSubmits; });
+            continue;
+        }
+
+        Walnut::Timer timer;
+
+        m_Renderer.Render(m_Camera);
+        PublishFrame(timer.ElapsedMillis());
+
+        const auto& settings = m_Renderer.GetSettings();
+        converged = settings.Adaptive && settings.Accum && m_Renderer.GetConvergedTileCount() == m_Renderer.GetTileCount();
+    }
+
+    // Queued before the stop, e.g. a save.
+    RunTasks();
+}
+
+bool RenderThread::ApplyInput()
+{
+    if (!m_Inputs.Acquire()) {
+        return false;
+    }
+
+    WL_PROFILE_SCOPE("RenderThread::ApplyInput");
+
+    const Input& input = m_Inputs.GetFront();
+    bool changed = input.Settings != m_Applied.Settings
+        || input.Sky != m_Applied.Sky
+        || input.Width != m_Applied.Width || input.Height != m_Applied.Height
+        || input.View.GetRayVersion() != m_Applied.View.GetRayVersion()
+        || input.SceneSnapshot != m_Applied.SceneSnapshot
+        || input.Resets != m_Applied.Resets;
+
+    // Restarts accumulation only if the snapshot differs from the last one.
+    if (input.SceneSnapshot) {
+        m_Renderer.SetScene(input.SceneSnapshot);
+    }
+    if (input.Resets != m_Applied.Resets) {
+        m_Renderer.ResetFrameIdx();
+    }
+
+    m_Renderer.GetSettings() = input.Settings;
+    m_Renderer.Sky = input.Sky;
+
+    m_Camera = input.View;
+    if (input.Width && input.Height) {
+        m_Renderer.OnResize(input.Width, input.Height);
+        m_Camera.OnResize(input.Width, input.Height);
+    }
+
+    m_Applied = input;
+    return changed;
+}
+
+void RenderThread::RunTasks()
+{
+    std::vector<std::function<void(Renderer&)>> tasks;
+    {
+        std::lock_guard lock(m_Mutex);
+        std::swap(tasks, m_Tasks);
+    }
+
+    for (auto& task : tasks) {
+        task(m_Renderer);
+    }
+}
+
+void RenderThread::PublishFrame(float renderMs)
+{
+    Frame& frame = m_Frames.GetBack();
+    frame.FrameIdx = m_Renderer.GetFrameIdx();
+    frame.PreviewScale = m_Renderer.GetPreviewScale();
+    frame.ConvergedTiles = m_Renderer.GetConvergedTileCount();
+    frame.TileCount = m_Renderer.GetTileCount();
+    frame.Stats = m_Renderer.GetStats();
+    frame.RenderMs = renderMs;
+
+    m_Frames.Publish();
+}
@@ -0,0 +1,124 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Camera.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "TripleBuffer.h"
+
+/**
+ * @brief Runs a @ref `Renderer` continuously on its own thread, decoupled from the UI loop. The UI
+ * submits its state every frame and picks up the latest finished frame, both through triple buffers,
+ * so neither side ever waits for the other.
+ */
+class RenderThread {
+public:
+    /// @brief Everything the render thread needs, the UI's latest one wins.
+    struct Input {
+        /// @brief Immutable, the UI publishes a new one after every edit, see @ref `Renderer::SetScene`.
+        std::shared_ptr<const Scene> SceneSnapshot;
+        Camera View { 45.0f, 0.1f, 100.0f };
+        uint32_t Width = 0, Height = 0;
+        Renderer::Settings Settings;
+        bool Sky = true;
+        bool Paused = false;
+
+        /**
+         * @brief Bumped by the UI for every @ref `Renderer::ResetFrameIdx` it wants, e.g. when the camera
+         * moves. A count rather than a flag, as inputs published in between may be skipped.
+         */
+        uint32_t Resets = 0;
+    };
+
+    /// @brief A rendered frame and the renderer's state after it.
+    struct Frame {
+        /// @brief `Width * Height` ABGR words with row 0 at the bottom.
+        std::vector<uint32_t> Pixels;
+        uint32_t Width = 0, Height = 0;
+
+        uint32_t FrameIdx = 0;
+        uint32_t PreviewScale = 1;
+        uint32_t ConvergedTiles = 0, TileCount = 0;
+        RenderStats Stats;
+        float RenderMs = 0.0f;
+    };
+
+public:
+    RenderThread();
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    /// @brief UI thread: replaces the render thread's input, taken before its next frame.
+    void Submit(const Input& input);
+
+    /// @brief UI thread: true if a frame finished since the last call, @ref `GetFrame` is then that frame.
+    bool AcquireFrame() { return m_Frames.Acquire(); }
+    const Frame& GetFrame() const { return m_Frames.GetFront(); }
+
+    /**
+     * @brief Runs `task` on the render thread between two frames, e.g. to hand the accumulated image to an
+     * @ref `ImageWriter`. Tasks run in order, after the input submitted last before them is applied.
+     */
+    void Post(std::function<void(Renderer&)> task);
+
+private:
+    /**
+     * @brief Renders into the back frame of `m_Frames`, without copying on the render thread. The UI
+     * thread copies the frames it shows into the viewport's staging buffer.
+     */
+    class FrameSink : public ImageSink {
+    public:
+        explicit FrameSink(TripleBuffer<Frame>& frames)
+            : m_Frames(frames)
+        {
+        }
+
+        void OnResize(uint32_t width, uint32_t height) override;
+        void SetData(const uint32_t*) override { }
+        uint32_t* BeginFrame() override;
+
+    private:
+        TripleBuffer<Frame>& m_Frames;
+        uint32_t m_Width = 0, m_Height = 0;
+    };
+
+    void ThreadLoop();
+    /**
+     * @brief Takes the latest input, if any, and forwards its changes to the renderer.
+     * @return `true` if the image it renders differs from the last one.
+     */
+    bool ApplyInput();
+    void RunTasks();
+    void PublishFrame(float renderMs);
+
+private:
+    Renderer m_Renderer;
+    Camera m_Camera { 45.0f, 0.1f, 100.0f };
+    /// @brief The input applied last, render thread only.
+    Input m_Applied;
+
+    TripleBuffer<Input> m_Inputs;
+    TripleBuffer<Frame> m_Frames;
+    std::shared_ptr<FrameSink> m_Sink;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCV;
+    std::vector<std::function<void(Renderer&)>> m_Tasks;
+    /// @brief Inputs submitted so far, the idle render thread waits for the next one.
+    uint32_t m_SubmitCount = 0;
+    bool m_Stop = false;
+
+    std::thread m_Thread;
+};
+
+#endif // RENDER_THREAD_H
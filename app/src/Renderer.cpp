@@ -1,128 +1,794 @@
+#include "Walnut/Profiler.h"
+#include "Walnut/Timer.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <execution> // execution::par
-#include <numeric> // iota
+#include <algorithm> // count, fill, find, max, min, sort
+#include <cmath> // exp2
+#include <utility> // exchange, move
 
 #include "Color.h"
 #include "Renderer.h"
-#include "Walnut/Random.h"
+#include "Sampler.h"
+#include "Utils.h"
 
 namespace Utils {
 
-///@brief Convert RGBA to ABGR. `color` values must be clamped to `[0,1]`.
-static uint32_t Vec2Rgba(const glm::vec4& color)
+const float Inf = std::numeric_limits<float>::max();
+
+/// @brief Triangles per BVH leaf, the triangle test is scalar.
+constexpr uint32_t TriangleLeafSize = 4;
+
+/// @brief Leaf bounds of the sphere BVH.
+static AABB SphereBounds(const Sphere& sphere)
 {
-    auto r = (uint8_t)(color.r * 255.0f);
-    auto g = (uint8_t)(color.g * 255.0f);
-    auto b = (uint8_t)(color.b * 255.0f);
-    auto a = (uint8_t)(color.a * 255.0f);
+    glm::vec3 extent { glm::abs(sphere.Radius) };
+    return { sphere.Pos - extent, sphere.Pos + extent };
+}
 
-    // aa | bb | gg | rr -> 8 bytes
-    return (a << 24) | (b << 16) | (g << 8) | r;
+/// @brief Leaf bounds of a geometry's BVH, in object space.
+static std::vector<AABB> TriangleBounds(const MeshGeometry& geometry)
+{
+    std::vector<AABB> bounds(geometry.GetTriangleCount());
+
+    for (uint32_t tri = 0; tri < geometry.GetTriangleCount(); tri++) {
+        for (uint32_t k = 0; k < 3; k++) {
+            bounds[tri].Grow(geometry.Positions[geometry.Indices[tri * 3 + k]]);
+        }
+    }
+
+    return bounds;
 }
 
-const float Inf = std::numeric_limits<float>::max();
+/// @brief World bounds of `box` under `transform`, through its eight corners.
+static AABB TransformBounds(const AABB& box, const glm::mat4& transform)
+{
+    AABB world;
+    for (uint32_t corner = 0; corner < 8; corner++) {
+        glm::vec3 point {
+            corner & 1 ? box.Max.x : box.Min.x,
+            corner & 2 ? box.Max.y : box.Min.y,
+            corner & 4 ? box.Max.z : box.Min.z,
+        };
+        world.Grow(glm::vec3(transform * glm::vec4(point, 1.0f)));
+    }
+
+    return world;
+}
+
+///@brief Interleave the bits of `x` and `y`, so nearby tiles get nearby codes.
+static uint32_t MortonCode(uint32_t x, uint32_t y)
+{
+    auto spread = [](uint32_t v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+
+    return spread(x) | (spread(y) << 1);
+}
+
+static float Luminance(const glm::vec3& color)
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+/**
+ * @brief Standard error of the mean luminance of `samples` samples, relative to that mean.
+ * The offset keeps near black pixels, whose noise is invisible anyway, from never converging.
+ */
+static float RelativeError(const glm::vec3& sum, float sumSq, uint32_t samples)
+{
+    float mean = Luminance(sum) / (float)samples;
+    float variance = std::max(0.0f, sumSq / (float)samples - mean * mean);
+
+    return glm::sqrt(variance / (float)samples) / (mean + 0.01f);
+}
 
 } // namespace Utils
 
 void Renderer::OnResize(uint32_t width, uint32_t height)
 {
-    if (m_FinalImage) {
-        bool resizeNotNeeded = m_FinalImage->GetWidth() == width && m_FinalImage->GetHeight() == height;
-        if (resizeNotNeeded) {
-            return;
-        }
+    bool resizeNotNeeded = m_AccumData && m_Width == width && m_Height == height;
+    if (resizeNotNeeded) {
+        return;
+    }
 
-        m_FinalImage->Resize(width, height);
-    } else {
-        m_FinalImage = std::make_shared<Walnut::Image>(width, height,
-            Walnut::ImageFormat::RGBA);
+    m_Width = width;
+    m_Height = height;
+
+    if (m_Sink) {
+        m_Sink->OnResize(width, height);
     }
 
     uint32_t imgBufferLen = width * height;
 
+    // Allocated by `Render` only when the sink cannot take the frame directly.
     delete[] m_ImageData;
-    m_ImageData = new uint32_t[imgBufferLen];
+    m_ImageData = nullptr;
 
     delete[] m_AccumData;
-    m_AccumData = new glm::vec4[imgBufferLen];
+    m_AccumData = new glm::vec3[imgBufferLen];
+
+    delete[] m_AccumSqData;
+    m_AccumSqData = new float[imgBufferLen];
+
+    m_PreviewColors.clear();
+
+    ResetFrameIdx();
+}
+
+void Renderer::SetSink(std::shared_ptr<ImageSink> sink)
+{
+    m_Sink = std::move(sink);
 
-    m_ImgHori.resize(width);
-    m_ImgVert.resize(height);
-    std::iota(std::begin(m_ImgHori), std::end(m_ImgHori), 0);
-    std::iota(std::begin(m_ImgVert), std::end(m_ImgVert), 0);
+    if (m_Sink && m_AccumData) {
+        m_Sink->OnResize(m_Width, m_Height);
+    }
 }
 
-void Renderer::Render(const Scene& scene, const Camera& camera)
+void Renderer::Render(const Camera& camera)
 {
-    uint32_t wt = m_FinalImage->GetWidth(), ht = m_FinalImage->GetHeight();
+    WL_PROFILE_SCOPE("Renderer::Render");
+    Walnut::Timer frameTimer;
+
+    uint32_t wt = m_Width, ht = m_Height;
+
+    UpdateAccel();
 
-    m_ActiveScene = &scene;
     m_ActiveCamera = &camera;
 
-    if (m_FrameIdx == 1) {
-        std::memset(m_AccumData, 0, wt * ht * sizeof(glm::vec4));
+    UpdateScheduler(wt, ht);
+    UpdateRayCache(camera);
+
+    RT_STAT(m_ThreadStats.assign(m_ThreadPool->GetThreadCount(), {}));
+
+    if (m_AccumAdaptive != m_Settings.Adaptive) {
+        m_AccumAdaptive = m_Settings.Adaptive;
+        ResetFrameIdx();
     }
 
-    std::for_each(std::execution::par, std::begin(m_ImgVert), std::end(m_ImgVert),
-        [this, wt](uint32_t y) {
-            std::for_each(std::execution::par, std::begin(m_ImgHori), std::end(m_ImgHori),
-                [this, y, wt](uint32_t x) {
-                    auto color = PerPixel(x, y);
+    const uint32_t previewScale = UpdatePreviewScale();
+    const bool wavefront = m_Settings.Wavefront;
+    const bool budgeted = previewScale == 1 && !wavefront && m_Settings.FrameBudgetMs > 0.0f;
 
-                    auto& accumColor = m_AccumData[x + y * wt];
-                    accumColor += color;
+    // Whole frames cannot finish a frame begun within a budget, its sampled tiles would repeat their sample.
+    if (!budgeted && m_PassTile > 0) {
+        ResetFrameIdx();
+    }
 
-                    color = glm::clamp(accumColor / (float)m_FrameIdx, { 0 }, { 1 });
+    // The accumulation buffers are cleared lazily, by the first sample of each tile.
+    if (m_FrameIdx == 1 && previewScale == 1 && !budgeted) {
+        std::fill(std::begin(m_TileSamples), std::end(m_TileSamples), 0);
+        std::fill(std::begin(m_TileConverged), std::end(m_TileConverged), 0);
+        std::fill(std::begin(m_TileStale), std::end(m_TileStale), 0);
+    }
 
-                    m_ImageData[x + y * wt] = Utils::Vec2Rgba(color);
-                });
+    // Zero-copy when the sink allows it, e.g. straight into the viewport's mapped staging buffer.
+    uint32_t* pixels = m_Sink ? m_Sink->BeginFrame() : nullptr;
+    if (!pixels) {
+        if (!m_ImageData) {
+            m_ImageData = new uint32_t[wt * ht];
+        }
+        pixels = m_ImageData;
+    }
+
+    if (previewScale > 1) {
+        RenderPreview(previewScale, pixels);
+    } else if (budgeted) {
+        RenderWithinBudget(pixels);
+    } else if (wavefront) {
+        TraceWavefront();
+    }
+
+    // Each tile is resolved right after it is sampled, while its accumulated pixels are still in cache.
+    if (previewScale == 1 && !budgeted) {
+        m_ThreadPool->ParallelFor((uint32_t)m_Tiles.size(), [this, pixels, wavefront](uint32_t tileIdx) {
+            if (TileNeedsSamples(tileIdx)) {
+                AccumulateTile(tileIdx, wavefront);
+            }
+
+            // Converged tiles are still resolved, `pixels` may be a staging buffer holding an older frame.
+            ResolveTile(tileIdx, pixels);
+        });
+    }
+
+    if (pixels != m_ImageData) {
+        m_Sink->EndFrame();
+    } else if (m_Sink) {
+        m_Sink->SetData(m_ImageData);
+    }
+
+#ifdef RT_STATS
+    m_Stats = {};
+    for (auto& thread : m_ThreadStats) {
+        m_Stats += thread.Stats;
+    }
+
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < m_Tiles.size(); i++) {
+        const auto& tile = m_Tiles[i];
+        accumulated += (uint64_t)m_TileSamples[i] * (tile.X1 - tile.X0) * (tile.Y1 - tile.Y0);
+    }
+
+    m_Stats.SamplesPerPixel = wt > 0 && ht > 0 ? (float)((double)accumulated / ((double)wt * ht)) : 0.0f;
+    m_Stats.FrameSeconds = frameTimer.Elapsed();
+#endif
+
+    if (budgeted) {
+        // Advanced per finished frame by `RenderWithinBudget`.
+        m_FullFrameMs = m_TileCostMs * (float)m_Tiles.size();
+        return;
+    }
+
+    // Tracing dominates, so a full frame costs about the preview times its block area.
+    m_FullFrameMs = frameTimer.ElapsedMillis() * (float)(previewScale * previewScale);
+
+    // Previews are not accumulated, the next frame samples from scratch.
+    m_FrameIdx = m_Settings.Accum && previewScale == 1 ? m_FrameIdx + 1 : 1;
+    m_SeedIdx++;
+}
+
+void Renderer::RenderWithinBudget(uint32_t* pixels)
+{
+    WL_PROFILE_SCOPE("Renderer::RenderWithinBudget");
+    Walnut::Timer timer;
+
+    const uint32_t tileCount = (uint32_t)m_Tiles.size();
+    // Fewer tiles than threads would leave some of them idle.
+    const uint32_t minBatch = std::min(tileCount, m_ThreadPool->GetThreadCount());
+    // The resolve after sampling takes about as long as last time.
+    const float budgetMs = m_Settings.FrameBudgetMs - m_ResolveMs;
+
+    do {
+        // A pass that starts over, after a reset or without accumulation, keeps the old samples on screen
+        // until each tile's first new one. Whatever `pixels` held may be a frame several uploads old.
+        if (m_FrameIdx == 1 && m_PassTile == 0) {
+            for (uint32_t i = 0; i < tileCount; i++) {
+                m_TileStale[i] = m_TileSamples[i] > 0;
+            }
+            std::fill(std::begin(m_TileConverged), std::end(m_TileConverged), 0);
+        }
+
+        // As many tiles as the remaining time allows at the measured cost, one batch per thread at least.
+        float remainingMs = budgetMs - timer.ElapsedMillis();
+        uint32_t batch = m_TileCostMs > 0.0f ? (uint32_t)std::min(remainingMs / m_TileCostMs, (float)tileCount) : minBatch;
+        // Not `std::clamp`, near the end of a pass fewer tiles than `minBatch` may be left.
+        batch = std::min(std::max(batch, minBatch), tileCount - m_PassTile);
+
+        Walnut::Timer batchTimer;
+        const uint32_t first = m_PassStart + m_PassTile;
+        m_ThreadPool->ParallelFor(batch, [this, first, tileCount](uint32_t i) {
+            const uint32_t tileIdx = (first + i) % tileCount;
+            if (TileNeedsSamples(tileIdx)) {
+                AccumulateTile(tileIdx, false);
+            }
         });
 
-    m_FinalImage->SetData(m_ImageData);
+        // Smoothed, converged tiles and scene changes make single batches noisy.
+        float costMs = batchTimer.ElapsedMillis() / (float)batch;
+        m_TileCostMs = m_TileCostMs > 0.0f ? 0.5f * (m_TileCostMs + costMs) : costMs;
+
+        m_PassTile += batch;
+        if (m_PassTile == tileCount) {
+            m_PassTile = 0;
+            m_FrameIdx = m_Settings.Accum ? m_FrameIdx + 1 : 1;
+            m_SeedIdx++;
 
-    m_FrameIdx = m_Settings.Accum ? m_FrameIdx + 1 : 1;
+            // Another frame would repeat this one's samples, or find nothing left to sample.
+            if (!m_Settings.Accum || (m_Settings.Adaptive && GetConvergedTileCount() == tileCount)) {
+                break;
+            }
+        }
+    } while (timer.ElapsedMillis() + m_TileCostMs * (float)minBatch <= budgetMs);
+
+    Walnut::Timer resolveTimer;
+    m_ThreadPool->ParallelFor(tileCount, [this, pixels](uint32_t tileIdx) {
+        ResolveTile(tileIdx, pixels);
+    });
+    m_ResolveMs = resolveTimer.ElapsedMillis();
 }
 
-glm::vec4 Renderer::PerPixel(uint32_t x, uint32_t y)
+uint32_t Renderer::UpdatePreviewScale()
 {
-    auto imgWt = m_FinalImage->GetWidth();
-    Ray ray = {
-        .Origin = m_ActiveCamera->GetPosition(),
-        .Direction = m_ActiveCamera->GetRayDirections()[x + y * imgWt]
+    const bool restart = std::exchange(m_PreviewRestart, false);
+
+    if (!m_Settings.Preview) {
+        m_PreviewScale = 1;
+    } else if (restart) {
+        // Coarsest block needed to fit the budget, full resolution when it fits already.
+        uint32_t scale = 1;
+        while (scale * 2 <= m_Settings.PreviewMaxScale && m_FullFrameMs > m_Settings.PreviewBudgetMs * (float)(scale * scale)) {
+            scale *= 2;
+        }
+        m_PreviewScale = scale;
+    } else {
+        // Nothing changed since the last frame, refine.
+        m_PreviewScale = std::max(1u, m_PreviewScale / 2);
+    }
+
+    return m_PreviewScale;
+}
+
+void Renderer::RenderPreview(uint32_t scale, uint32_t* pixels)
+{
+    WL_PROFILE_SCOPE("Renderer::RenderPreview");
+
+    const uint32_t wt = m_Width, ht = m_Height;
+    const uint32_t blocksX = (wt + scale - 1) / scale;
+    const uint32_t blocksY = (ht + scale - 1) / scale;
+
+    const Utils::ResolveParams params {
+        .Scale = std::exp2(m_Settings.Exposure),
+        .Aces = m_Settings.Tonemap == Tonemapper::ACES,
+        .Srgb = m_Settings.SRGB,
     };
 
-    glm::vec3 skyColor = Color::Sky_300;
+    // Kept for the tiles a budgeted frame has not reached yet, once the preview is refined.
+    m_PreviewColors.resize((size_t)blocksX * blocksY);
+    m_PreviewBlock = scale;
+    std::fill(std::begin(m_TileSamples), std::end(m_TileSamples), 0);
+    std::fill(std::begin(m_TileStale), std::end(m_TileStale), 0);
+
+    m_ThreadPool->ParallelFor(blocksY, [this, pixels, scale, wt, ht, blocksX, &params](uint32_t by) {
+        glm::vec3* colors = m_PreviewColors.data() + (size_t)by * blocksX;
+        std::vector<uint32_t> packed(blocksX);
+
+        // Block centers, clamped into the partial blocks at the right and top edges.
+        const uint32_t y0 = by * scale;
+        const uint32_t sampleY = std::min(y0 + scale / 2, ht - 1);
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            colors[bx] = PerPixel(std::min(bx * scale + scale / 2, wt - 1), sampleY);
+        }
+        RT_STAT(GetThreadStats().Samples += blocksX);
 
-    // Change the contribution of `light` for each bounce.
-    glm::vec3 contribution { 1.0f };
-    glm::vec3 light = Color::Black;
+        Utils::ResolveRow(colors, blocksX, params, packed.data());
 
-    const int bounces = 8;
+        for (uint32_t y = y0; y < std::min(ht, y0 + scale); y++) {
+            uint32_t* row = pixels + (size_t)y * wt;
+            for (uint32_t x = 0; x < wt; x++) {
+                row[x] = packed[x / scale];
+            }
+        }
+    });
+}
+
+void Renderer::AccumulateTile(uint32_t tileIdx, bool wavefront)
+{
+    WL_PROFILE_SCOPE("Renderer::AccumulateTile");
 
-    for (int i = 0; i < bounces; i++) {
-        auto payload = TraceRay(ray);
+    const auto& tile = m_Tiles[tileIdx];
+    const uint32_t wt = m_Width;
+    const bool adaptive = m_Settings.Adaptive;
 
-        if (payload.HitDist < 0.0f) {
-            if (Sky) {
-                light += skyColor * contribution;
+    // A stale tile's first sample of this pass replaces the earlier ones.
+    if (m_TileStale[tileIdx]) {
+        m_TileStale[tileIdx] = 0;
+        m_TileSamples[tileIdx] = 0;
+    }
+
+    const uint32_t samples = ++m_TileSamples[tileIdx];
+    RT_STAT(GetThreadStats().Samples += (tile.X1 - tile.X0) * (tile.Y1 - tile.Y0));
+
+    // Overwrite whatever an earlier accumulation left, instead of clearing on reset.
+    const bool first = samples == 1;
+    float maxError = 0.0f;
+
+    for (uint32_t y = tile.Y0; y < tile.Y1; y++) {
+        for (uint32_t x = tile.X0; x < tile.X1; x++) {
+            uint32_t idx = x + y * wt;
+            glm::vec3 color = wavefront ? m_PathRadiance[idx] : PerPixel(x, y);
+
+            auto& accumColor = m_AccumData[idx];
+            accumColor = first ? color : accumColor + color;
+
+            if (adaptive) {
+                float luminance = Utils::Luminance(color);
+                auto& accumSq = m_AccumSqData[idx];
+                accumSq = first ? luminance * luminance : accumSq + luminance * luminance;
+
+                maxError = std::max(maxError, Utils::RelativeError(accumColor, accumSq, samples));
             }
-            break;
         }
+    }
+
+    if (adaptive && samples >= m_Settings.AdaptiveMinSamples && maxError < m_Settings.NoiseThreshold) {
+        m_TileConverged[tileIdx] = 1;
+    }
+}
+
+void Renderer::ResolveTile(uint32_t tileIdx, uint32_t* pixels) const
+{
+    WL_PROFILE_SCOPE("Renderer::ResolveTile");
+
+    const auto& tile = m_Tiles[tileIdx];
+    const uint32_t samples = m_TileSamples[tileIdx];
+
+    Utils::ResolveParams params {
+        .Scale = std::exp2(m_Settings.Exposure) / (float)std::max(samples, 1u),
+        .Aces = m_Settings.Tonemap == Tonemapper::ACES,
+        .Srgb = m_Settings.SRGB,
+    };
+
+    if (samples > 0) {
+        for (uint32_t y = tile.Y0; y < tile.Y1; y++) {
+            size_t row = tile.X0 + (size_t)y * m_Width;
+            Utils::ResolveRow(m_AccumData + row, tile.X1 - tile.X0, params, pixels + row);
+        }
+        return;
+    }
+
+    // Not sampled since a resize, black like a fresh viewport.
+    if (m_PreviewColors.empty()) {
+        for (uint32_t y = tile.Y0; y < tile.Y1; y++) {
+            std::fill_n(pixels + tile.X0 + (size_t)y * m_Width, tile.X1 - tile.X0, 0xff000000u);
+        }
+        return;
+    }
+
+    // Not sampled since the last preview, its blocks overlapping the tile.
+    const uint32_t block = m_PreviewBlock;
+    const uint32_t blocksX = (m_Width + block - 1) / block;
+    const uint32_t bx0 = tile.X0 / block, bx1 = (tile.X1 - 1) / block + 1;
+    std::vector<uint32_t> packed(bx1 - bx0);
+
+    for (uint32_t y = tile.Y0; y < tile.Y1; y++) {
+        if (y == tile.Y0 || y % block == 0) {
+            Utils::ResolveRow(m_PreviewColors.data() + (size_t)(y / block) * blocksX + bx0, bx1 - bx0, params, packed.data());
+        }
+
+        uint32_t* row = pixels + (size_t)y * m_Width;
+        for (uint32_t x = tile.X0; x < tile.X1; x++) {
+            row[x] = packed[x / block - bx0];
+        }
+    }
+}
 
-        auto& sphere = m_ActiveScene->Spheres[payload.ObjectIdx];
-        auto& material = m_ActiveScene->Materials[sphere.MatIdx];
+void Renderer::GetImage(std::vector<uint32_t>& out) const
+{
+    WL_PROFILE_SCOPE("Renderer::GetImage");
 
-        contribution *= material.Albedo;
-        light += material.GetEmission();
+    out.resize((size_t)m_Width * m_Height);
 
-        // Reflect about the normal, then jitter the reflected ray a bit (simulate roughness).
-        ray.Origin = payload.WorldPos + payload.WorldNormal * 0.0001f;
-        ray.Direction = glm::normalize(payload.WorldNormal + Walnut::Random::InUnitSphere());
+    // Nothing rendered at this size yet.
+    if (!m_ThreadPool || m_TilesWidth != m_Width || m_TilesHeight != m_Height) {
+        std::fill(out.begin(), out.end(), 0xff000000u);
+        return;
     }
 
-    return glm::vec4(light, 1.0f);
+    m_ThreadPool->ParallelFor((uint32_t)m_Tiles.size(), [this, &out](uint32_t tileIdx) {
+        ResolveTile(tileIdx, out.data());
+    });
+}
+
+void Renderer::GetHdrImage(std::vector<glm::vec4>& out) const
+{
+    out.assign((size_t)m_Width * m_Height, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    if (m_TilesWidth != m_Width || m_TilesHeight != m_Height) {
+        return;
+    }
+
+    const float exposure = std::exp2(m_Settings.Exposure);
+
+    for (uint32_t i = 0; i < m_Tiles.size(); i++) {
+        const auto& tile = m_Tiles[i];
+        if (m_TileSamples[i] == 0) {
+            continue;
+        }
+
+        const float scale = exposure / (float)m_TileSamples[i];
+        for (uint32_t y = tile.Y0; y < tile.Y1; y++) {
+            for (uint32_t x = tile.X0; x < tile.X1; x++) {
+                out[x + (size_t)y * m_Width] = glm::vec4(m_AccumData[x + (size_t)y * m_Width] * scale, 1.0f);
+            }
+        }
+    }
+}
+
+void Renderer::UpdateScheduler(uint32_t width, uint32_t height)
+{
+    uint32_t threadCount = m_Settings.ThreadCount ? m_Settings.ThreadCount : std::max(1u, std::thread::hardware_concurrency());
+    if (!m_ThreadPool || m_ThreadPool->GetThreadCount() != threadCount) {
+        m_ThreadPool = std::make_unique<ThreadPool>(threadCount);
+    }
+
+    uint32_t tileSize = std::max(1u, m_Settings.TileSize);
+    if (tileSize == m_TileSize && width == m_TilesWidth && height == m_TilesHeight) {
+        return;
+    }
+
+    m_TileSize = tileSize;
+    m_TilesWidth = width;
+    m_TilesHeight = height;
+
+    uint32_t tilesX = (width + tileSize - 1) / tileSize;
+    uint32_t tilesY = (height + tileSize - 1) / tileSize;
+
+    m_Tiles.clear();
+    m_Tiles.reserve(tilesX * tilesY);
+
+    for (uint32_t ty = 0; ty < tilesY; ty++) {
+        for (uint32_t tx = 0; tx < tilesX; tx++) {
+            m_Tiles.push_back(Tile {
+                .X0 = tx * tileSize,
+                .Y0 = ty * tileSize,
+                .X1 = std::min(width, (tx + 1) * tileSize),
+                .Y1 = std::min(height, (ty + 1) * tileSize),
+            });
+        }
+    }
+
+    // Z-order keeps each worker's contiguous range of tiles compact on screen.
+    std::sort(std::begin(m_Tiles), std::end(m_Tiles), [tileSize](const Tile& a, const Tile& b) {
+        return Utils::MortonCode(a.X0 / tileSize, a.Y0 / tileSize) < Utils::MortonCode(b.X0 / tileSize, b.Y0 / tileSize);
+    });
+
+    m_TileSamples.assign(m_Tiles.size(), 0);
+    m_TileConverged.assign(m_Tiles.size(), 0);
+    m_TileStale.assign(m_Tiles.size(), 0);
+    m_PassStart = m_PassTile = 0;
+    ResetFrameIdx();
+}
+
+uint32_t Renderer::GetConvergedTileCount() const
+{
+    return (uint32_t)std::count(std::begin(m_TileConverged), std::end(m_TileConverged), 1);
+}
+
+void Renderer::UpdateRayCache(const Camera& camera)
+{
+    WL_PROFILE_SCOPE("Renderer::UpdateRayCache");
+
+    if (!m_Settings.CacheRayDirections) {
+        m_RayDirections = {};
+        m_RayCacheCamera = nullptr;
+        return;
+    }
+
+    uint32_t wt = m_Width, ht = m_Height;
+
+    bool upToDate = m_RayCacheCamera == &camera && m_RayCacheVersion == camera.GetRayVersion()
+        && m_RayDirections.size() == (size_t)wt * ht;
+    if (upToDate) {
+        return;
+    }
+
+    m_RayDirections.resize((size_t)wt * ht);
+    m_RayCacheCamera = &camera;
+    m_RayCacheVersion = camera.GetRayVersion();
+
+    m_ThreadPool->ParallelFor(ht, [this, &camera, wt](uint32_t y) {
+        for (uint32_t x = 0; x < wt; x++) {
+            m_RayDirections[x + y * wt] = camera.GetRayDirection(x, y);
+        }
+    });
+}
+
+void Renderer::SetScene(std::shared_ptr<const Scene> scene)
+{
+    if (scene == m_Scene) {
+        return;
+    }
+
+    if (!m_Scene) {
+        m_SpheresRebuild = m_MeshesRebuild = true;
+        ResetFrameIdx();
+    } else {
+        auto changes = SceneChanges::Diff(*m_Scene, *scene);
+
+        // Refits degrade the tree the further spheres move, most of them moving is rather a new scene.
+        m_SpheresRebuild |= changes.SphereCount || changes.MovedSpheres.size() > scene->Spheres.size() / 2;
+        m_MovedSpheres.insert(std::end(m_MovedSpheres), std::begin(changes.MovedSpheres), std::end(changes.MovedSpheres));
+        m_MeshesRebuild |= changes.Meshes;
+
+        if (changes.Any()) {
+            ResetFrameIdx();
+        }
+    }
+
+    m_Scene = std::move(scene);
+}
+
+void Renderer::SetAccel(BVH sphereBVH, std::vector<BVH> geometryBVHs)
+{
+    const Scene& scene = *m_Scene;
+    auto index = GeometryIndex::Build(scene.Meshes);
+
+    // Built for another scene, let `UpdateAccel` build the right ones.
+    bool matches = sphereBVH.GetPrimCount() == scene.Spheres.size() && geometryBVHs.size() == index.Geometries.size();
+    for (size_t i = 0; matches && i < geometryBVHs.size(); i++) {
+        matches = geometryBVHs[i].GetPrimCount() == index.Geometries[i]->GetTriangleCount();
+    }
+    if (!matches) {
+        return;
+    }
+
+    m_SphereBVH = std::move(sphereBVH);
+
+    // Later refits only update the bounds of moved spheres.
+    m_SphereBounds.resize(scene.Spheres.size());
+    for (size_t i = 0; i < scene.Spheres.size(); i++) {
+        m_SphereBounds[i] = Utils::SphereBounds(scene.Spheres[i]);
+    }
+
+    m_SphereSoA.Build(scene.Spheres, m_SphereBVH.GetPrimIndices());
+
+    m_Geometries = std::move(index.Geometries);
+    m_GeometryBVHs = std::move(geometryBVHs);
+    m_GeometrySoAs.resize(m_Geometries.size());
+    for (size_t i = 0; i < m_Geometries.size(); i++) {
+        m_GeometrySoAs[i].Build(*m_Geometries[i], m_GeometryBVHs[i].GetPrimIndices());
+    }
+
+    // The next render finds every geometry built and only places the instances.
+    m_SpheresRebuild = false;
+    m_MeshesRebuild = true;
+    m_MovedSpheres.clear();
+}
+
+void Renderer::UpdateAccel()
+{
+    WL_PROFILE_SCOPE("Renderer::UpdateAccel");
+
+    const Scene& scene = *m_Scene;
+
+    if (m_MeshesRebuild) {
+        UpdateMeshAccel();
+        m_MeshesRebuild = false;
+    }
+
+    if (m_SpheresRebuild) {
+        m_SphereBounds.resize(scene.Spheres.size());
+        for (size_t i = 0; i < scene.Spheres.size(); i++) {
+            m_SphereBounds[i] = Utils::SphereBounds(scene.Spheres[i]);
+        }
+
+        m_SphereBVH.Build(m_SphereBounds, Intersect::GetSpheresKernel().Lanes);
+    } else if (!m_MovedSpheres.empty()) {
+        for (uint32_t sphereIdx : m_MovedSpheres) {
+            m_SphereBounds[sphereIdx] = Utils::SphereBounds(scene.Spheres[sphereIdx]);
+        }
+
+        m_SphereBVH.Refit(m_SphereBounds);
+    } else {
+        return;
+    }
+
+    m_SphereSoA.Build(scene.Spheres, m_SphereBVH.GetPrimIndices());
+
+    m_SpheresRebuild = false;
+    m_MovedSpheres.clear();
+}
+
+void Renderer::UpdateMeshAccel()
+{
+    const Scene& scene = *m_Scene;
+    auto index = GeometryIndex::Build(scene.Meshes);
+
+    // Geometry of the previous scene keeps its bottom level, e.g. when only instances moved.
+    std::vector<BVH> bvhs(index.Geometries.size());
+    std::vector<TrianglesSoA> soas(index.Geometries.size());
+
+    for (size_t i = 0; i < index.Geometries.size(); i++) {
+        auto& geometry = index.Geometries[i];
+        auto it = std::find(m_Geometries.begin(), m_Geometries.end(), geometry);
+
+        if (it != m_Geometries.end()) {
+            size_t prev = it - m_Geometries.begin();
+            bvhs[i] = std::move(m_GeometryBVHs[prev]);
+            soas[i] = std::move(m_GeometrySoAs[prev]);
+        } else {
+            bvhs[i].Build(Utils::TriangleBounds(*geometry), Utils::TriangleLeafSize);
+            soas[i].Build(*geometry, bvhs[i].GetPrimIndices());
+        }
+    }
+
+    m_Geometries = std::move(index.Geometries);
+    m_GeometryBVHs = std::move(bvhs);
+    m_GeometrySoAs = std::move(soas);
+
+    m_Instances.clear();
+    std::vector<AABB> bounds;
+
+    for (uint32_t meshIdx = 0; meshIdx < scene.Meshes.size(); meshIdx++) {
+        uint32_t geometryIdx = index.OfMesh[meshIdx];
+        auto& bvh = m_GeometryBVHs[geometryIdx];
+        if (bvh.Empty()) {
+            continue;
+        }
+
+        glm::mat4 transform = scene.Meshes[meshIdx].GetTransform();
+        m_Instances.push_back({
+            .WorldToObject = glm::inverse(transform),
+            .NormalToWorld = glm::transpose(glm::inverse(glm::mat3(transform))),
+            .Geometry = geometryIdx,
+            .MeshIdx = meshIdx,
+        });
+
+        auto& root = bvh.GetNodes()[0];
+        bounds.push_back(Utils::TransformBounds({ root.Min, root.Max }, transform));
+    }
+
+    m_InstanceBVH.Build(bounds, 1);
+}
+
+glm::vec3 Renderer::PerPixel(uint32_t x, uint32_t y)
+{
+    PathState path = StartPath(x, y);
+
+    while (Bounce(path, TraceRay(path.PathRay))) { }
+
+    return path.Light;
+}
+
+Renderer::PathState Renderer::StartPath(uint32_t x, uint32_t y)
+{
+    uint32_t pixelIdx = x + y * m_Width;
+
+    return PathState {
+        .PathRay = {
+            .Origin = m_ActiveCamera->GetPosition(),
+            .Direction = m_RayDirections.empty() ? m_ActiveCamera->GetRayDirection(x, y) : m_RayDirections[pixelIdx] },
+        .Rng = Sampler(pixelIdx, m_SeedIdx),
+        .PixelIdx = pixelIdx,
+    };
+}
+
+bool Renderer::Bounce(PathState& path, const HitPayload& payload)
+{
+    glm::vec3 skyColor = Color::Sky_300;
+
+#ifdef RT_STATS
+    auto& stats = GetThreadStats();
+    (path.Depth == 0 ? stats.PrimaryRays : stats.SecondaryRays)++;
+    stats.Hits += payload.HitDist >= 0.0f;
+#endif
+
+    auto endPath = [&] {
+        RT_STAT(stats.PathLengths[std::min(path.Depth, RenderStats::PathLengthBins - 1)]++);
+        return false;
+    };
+
+    if (payload.HitDist < 0.0f) {
+        if (Sky) {
+            path.Light += skyColor * path.Contribution;
+        }
+        return endPath();
+    }
+
+    auto& material = m_Scene->Materials[payload.MatIdx];
+
+    // Change the contribution of `light` for each bounce.
+    path.Contribution *= material.Albedo;
+    path.Light += material.GetEmission() * path.RouletteWeight;
+
+    if (++path.Depth >= m_Settings.MaxBounces) {
+        return endPath();
+    }
+
+    // Survive with probability equal to the throughput, the surviving paths make up for the others.
+    if (m_Settings.RussianRoulette && path.Depth >= m_Settings.RouletteMinBounces) {
+        const auto& c = path.Contribution;
+        float survival = std::min(1.0f, std::max({ c.r, c.g, c.b }));
+
+        if (path.Rng.Float() >= survival) {
+            return endPath();
+        }
+
+        path.Contribution /= survival;
+        path.RouletteWeight /= survival;
+    }
+
+    // Diffuse bounce, cosine weighted around the normal.
+    path.PathRay.Origin = payload.WorldPos + payload.WorldNormal * 0.0001f;
+    path.PathRay.Direction = path.Rng.CosineHemisphere(payload.WorldNormal);
+
+    return true;
 }
 
 Renderer::HitPayload Renderer::TraceRay(const Ray& ray)
@@ -133,46 +799,70 @@ Renderer::HitPayload Renderer::TraceRay(const Ray& ray)
     // b = ray direction
     // r = radius
     // t = hit distance
+    //
+    // Solved for a whole BVH leaf at once by the SIMD kernel, see `Intersect.cpp`.
 
-    int closestSphereIdx = -1;
+    int closestSlot = -1;
     float hitDist = Utils::Inf;
 
-    for (int idx = 0; idx < m_ActiveScene->Spheres.size(); idx++) {
-        auto& sphere = m_ActiveScene->Spheres[idx];
-        auto origin = ray.Origin - sphere.Pos;
-
-        float A = glm::dot(ray.Direction, ray.Direction);
-        float B = 2.0f * glm::dot(origin, ray.Direction);
-        float C = glm::dot(origin, origin) - sphere.Radius * sphere.Radius;
-
-        // B^2 - 4AC
-        float discriminant = B * B - 4.0f * A * C;
-
-        if (discriminant < 0.0f) {
-            continue;
-        }
-
-        // 2 Quadratic Roots: (-B ± √D) / 2A
+    const auto kernel = Intersect::GetSpheresKernel().Fn;
+    RT_STAT(auto& stats = GetThreadStats());
+
+    m_SphereBVH.Traverse(ray, hitDist, [&](uint32_t first, uint32_t count) {
+        RT_STAT(stats.SphereTests += count);
+        kernel(m_SphereSoA, ray, first, count, hitDist, closestSlot);
+    });
+
+    // Bounded by the closest sphere, so only nearer instances and triangles are visited.
+    if (!m_InstanceBVH.Empty()) {
+        int closestTriangle = -1;
+        uint32_t closestInstance = 0;
+        glm::vec2 barycentric { 0.0f };
+
+        m_InstanceBVH.Traverse(ray, hitDist, [&](uint32_t first, uint32_t count) {
+            for (uint32_t i = first; i < first + count; i++) {
+                uint32_t instanceIdx = m_InstanceBVH.GetPrimIndices()[i];
+                auto& instance = m_Instances[instanceIdx];
+
+                // Not normalized, so distances along it are distances along `ray`.
+                Ray objectRay {
+                    glm::vec3(instance.WorldToObject * glm::vec4(ray.Origin, 1.0f)),
+                    glm::vec3(instance.WorldToObject * glm::vec4(ray.Direction, 0.0f)),
+                };
+                Intersect::WatertightRay watertightRay(objectRay);
+                auto& triangles = m_GeometrySoAs[instance.Geometry];
+                int slot = -1;
+
+                m_GeometryBVHs[instance.Geometry].Traverse(objectRay, hitDist, [&](uint32_t triFirst, uint32_t triCount) {
+                    RT_STAT(stats.TriangleTests += triCount);
+                    Intersect::Triangles(triangles, watertightRay, triFirst, triCount, hitDist, slot, barycentric);
+                });
 
-        // float t0 = (-B + glm::sqrt(discriminant)) / (2.0f * A);
-        float closestHit = (-B - glm::sqrt(discriminant)) / (2.0f * A);
+                if (slot >= 0) {
+                    closestTriangle = slot;
+                    closestInstance = instanceIdx;
+                }
+            }
+        });
 
-        if (closestHit > 0.0f && closestHit < hitDist) {
-            hitDist = closestHit;
-            closestSphereIdx = idx;
+        if (closestTriangle >= 0) {
+            return ClosestHitTriangle(ray, hitDist, closestInstance, closestTriangle, barycentric);
         }
     }
 
-    if (closestSphereIdx < 0.0f) {
+    if (closestSlot < 0) {
         return Miss(ray);
     }
 
+    // SoA slots follow BVH order, map back to the scene's sphere.
+    int closestSphereIdx = (int)m_SphereBVH.GetPrimIndices()[closestSlot];
+
     return ClosestHit(ray, hitDist, closestSphereIdx);
 }
 
 Renderer::HitPayload Renderer::ClosestHit(const Ray& ray, float hitDist, int objectIdx)
 {
-    auto& closestSphere = m_ActiveScene->Spheres[objectIdx];
+    auto& closestSphere = m_Scene->Spheres[objectIdx];
     auto shiftedOrigin = ray.Origin - closestSphere.Pos;
     auto shiftedWorldPos = shiftedOrigin + ray.Direction * hitDist;
 
@@ -180,7 +870,38 @@ Renderer::HitPayload Renderer::ClosestHit(const Ray& ray, float hitDist, int obj
         .HitDist = hitDist,
         .WorldPos = shiftedWorldPos + closestSphere.Pos,
         .WorldNormal = glm::normalize(shiftedWorldPos),
-        .ObjectIdx = objectIdx
+        .ObjectIdx = objectIdx,
+        .MatIdx = closestSphere.MatIdx,
+    };
+}
+
+Renderer::HitPayload Renderer::ClosestHitTriangle(const Ray& ray, float hitDist, uint32_t instanceIdx, int slot, const glm::vec2& barycentric)
+{
+    auto& instance = m_Instances[instanceIdx];
+    auto& triangles = m_GeometrySoAs[instance.Geometry];
+    auto& geometry = *m_Geometries[instance.Geometry];
+
+    glm::vec3 normal;
+    if (geometry.Normals.empty()) {
+        normal = glm::cross(triangles.V1[slot] - triangles.V0[slot], triangles.V2[slot] - triangles.V0[slot]);
+    } else {
+        const uint32_t* idx = &geometry.Indices[triangles.TriIndices[slot] * 3];
+        normal = (1.0f - barycentric.x - barycentric.y) * geometry.Normals[idx[0]]
+            + barycentric.x * geometry.Normals[idx[1]] + barycentric.y * geometry.Normals[idx[2]];
+    }
+
+    // Meshes need not be closed or consistently wound, face the side the ray came from.
+    normal = glm::normalize(instance.NormalToWorld * normal);
+    if (glm::dot(normal, ray.Direction) > 0.0f) {
+        normal = -normal;
+    }
+
+    return HitPayload {
+        .HitDist = hitDist,
+        .WorldPos = ray.Origin + ray.Direction * hitDist,
+        .WorldNormal = normal,
+        .ObjectIdx = (int)instance.MeshIdx,
+        .MatIdx = m_Scene->Meshes[instance.MeshIdx].MatIdx,
     };
 }
 
@@ -1,47 +1,275 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
-#include "Walnut/Image.h"
 #include <glm/glm.hpp>
 
+#include <limits>
 #include <memory>
 
+#include "BVH.h"
 #include "Camera.h"
+#include "ImageSink.h"
+#include "Intersect.h"
 #include "Ray.h"
+#include "RenderStats.h"
+#include "Sampler.h"
 #include "Scene.h"
+#include "ThreadPool.h"
 
-/// @brief Owns Final Image and its data. Handles creating and resizing image.
+/// @brief Owns the CPU framebuffer and accumulation data. Finished frames are passed to an @ref `ImageSink`.
 class Renderer {
 public:
+    /// @brief Display transform of the resolve, see @ref `Settings::Tonemap`.
+    enum class Tonemapper {
+        Clamp,
+        ACES,
+    };
+
     struct Settings {
         bool Accum = true;
+
+        /// @brief Render threads including the calling one, `0` uses every hardware thread.
+        uint32_t ThreadCount = 0;
+        /// @brief Edge length in pixels of the square tiles handed to the render threads.
+        uint32_t TileSize = 16;
+        /**
+         * @brief Keep a `width * height` buffer of primary ray directions, refilled on the render
+         * threads when the camera moves. Off generates them per pixel from @ref `Camera::GetRayDirection`.
+         */
+        bool CacheRayDirections = false;
+
+        /**
+         * @brief Trace the paths of all pixels one bounce at a time, from a shared ray queue with
+         * terminated paths compacted out, instead of each pixel's whole path at once.
+         */
+        bool Wavefront = false;
+        /// @brief Wavefront only: group the queue by ray direction octant before every bounce.
+        bool SortRays = true;
+
+        /// @brief Rays per path, including the primary ray.
+        uint32_t MaxBounces = 8;
+        /**
+         * @brief End paths at random once their contribution is low, with the survivors weighted up
+         * so the image stays unbiased. Starts after `RouletteMinBounces` bounces.
+         */
+        bool RussianRoulette = true;
+        uint32_t RouletteMinBounces = 3;
+
+        /// @brief Stop sampling tiles once every pixel in them is below `NoiseThreshold`.
+        bool Adaptive = false;
+        /// @brief Standard error of a pixel's mean luminance, relative to that mean.
+        float NoiseThreshold = 0.02f;
+        /// @brief Samples a tile takes before its noise estimate is trusted.
+        uint32_t AdaptiveMinSamples = 16;
+
+        /// @brief In stops, radiance is scaled by `2^Exposure` for display and HDR export.
+        float Exposure = 0.0f;
+        /// @brief Maps radiance to the displayed `[0,1]`, accumulation always stays linear.
+        Tonemapper Tonemap = Tonemapper::Clamp;
+        /// @brief Encode displayed pixels with the sRGB curve rather than writing linear values.
+        bool SRGB = false;
+
+        /**
+         * @brief After every reset, e.g. while the camera moves, trace one path per block of pixels,
+         * the smallest power of two block that fits `PreviewBudgetMs`. Once the resets stop, the block
+         * halves every frame and accumulation starts at full resolution.
+         */
+        bool Preview = false;
+        /// @brief Largest preview block edge in pixels.
+        uint32_t PreviewMaxScale = 8;
+        float PreviewBudgetMs = 25.0f;
+
+        /**
+         * @brief Time one @ref `Render` call may spend sampling, `0` always renders whole frames. Tiles are
+         * sampled in batches sized from their measured cost, a frame left unfinished continues on the next
+         * call and a finished one starts the next while time remains. Tiles not sampled since a reset show
+         * the last preview, or their previous samples. Wavefront frames are always whole.
+         */
+        float FrameBudgetMs = 0.0f;
+
+        bool operator==(const Settings&) const = default;
     };
 
 public:
     Renderer() = default;
 
-    /// @brief Creates image if needed, then resizes it.
+    /// @brief Resizes the framebuffers and the sink, restarts accumulation.
     void OnResize(uint32_t width, uint32_t height);
 
-    /// @brief Call this in main loop, to create the final image.
-    void Render(const Scene& scene, const Camera& camera);
+    /**
+     * @brief Renders the scene of the last @ref `SetScene` from `camera`, call this in the main loop to
+     * create the final image. `camera` is only used during the call.
+     */
+    void Render(const Camera& camera);
 
-    auto GetFinalImage() const { return m_FinalImage; }
+    /**
+     * @brief Adopts an immutable snapshot of the scene for the following renders. Only what differs from
+     * the previous snapshot is invalidated, see @ref `SceneChanges`: moved spheres refit the sphere BVH,
+     * added or removed ones rebuild it. Changed meshes rebuild the top level of the mesh BVH, over
+     * instances, and the bottom level of geometry new to the scene only. Accumulation restarts only if
+     * anything differs at all.
+     */
+    void SetScene(std::shared_ptr<const Scene> scene);
+    const std::shared_ptr<const Scene>& GetScene() const { return m_Scene; }
+
+    /// @brief Receives every frame, optional. Without one, read @ref `GetImageData` after `Render`.
+    void SetSink(std::shared_ptr<ImageSink> sink);
+
+    uint32_t GetWidth() const { return m_Width; }
+    uint32_t GetHeight() const { return m_Height; }
+
+    /**
+     * @brief Last rendered frame, `width * height` ABGR words.
+     * `nullptr` when the sink takes frames zero-copy through @ref `ImageSink::BeginFrame`.
+     */
+    const uint32_t* GetImageData() const { return m_ImageData; }
+    uint32_t GetFrameIdx() const { return m_FrameIdx; }
 
     Settings& GetSettings() { return m_Settings; }
-    void ResetFrameIdx() { m_FrameIdx = 1; }
+    void ResetFrameIdx()
+    {
+        m_FrameIdx = 1;
+        // Budgeted passes restart where the last one stopped, so resets every frame still reach every tile.
+        m_PassStart = m_Tiles.empty() ? 0 : (m_PassStart + m_PassTile) % (uint32_t)m_Tiles.size();
+        m_PassTile = 0;
+        m_PreviewRestart = true;
+    }
+
+    /// @brief Block edge of the last frame's preview, `1` when it was rendered at full resolution.
+    uint32_t GetPreviewScale() const { return m_PreviewScale; }
+
+    /**
+     * @brief Linear radiance of the accumulated image, scaled by the exposure but not tonemapped,
+     * `width * height` RGBA floats with row 0 at the bottom. Resolved on demand, e.g. for @ref `ImageIO::WriteExr`.
+     */
+    void GetHdrImage(std::vector<glm::vec4>& out) const;
+
+    /**
+     * @brief Resolves the accumulated image as displayed, `width * height` ABGR words with row 0 at the
+     * bottom. Unlike @ref `GetImageData` it is valid with a zero-copy sink, e.g. to hand to @ref `ImageWriter`.
+     */
+    void GetImage(std::vector<uint32_t>& out) const;
+
+    /// @brief Counters of the last frame, all zero unless built with `RT_STATS`.
+    const RenderStats& GetStats() const { return m_Stats; }
+
+    uint32_t GetTileCount() const { return (uint32_t)m_Tiles.size(); }
+    /// @brief Tiles that stopped sampling in adaptive mode, equals @ref `GetTileCount` once the image converged.
+    uint32_t GetConvergedTileCount() const;
+
+    /// @brief BVHs of the last rendered scene, e.g. to store them with @ref `SceneCache::Save`.
+    const BVH& GetSphereBVH() const { return m_SphereBVH; }
+    /// @brief Per distinct mesh geometry, in the order of @ref `GeometryIndex::Build`.
+    const std::vector<BVH>& GetGeometryBVHs() const { return m_GeometryBVHs; }
+
+    /**
+     * @brief Adopts BVHs built earlier for the scene of the last @ref `SetScene`, so the next @ref `Render`
+     * skips their build. Only the top level over mesh instances is still built, it is cheap.
+     */
+    void SetAccel(BVH sphereBVH, std::vector<BVH> geometryBVHs);
 
     bool Sky = true;
 
 private:
+    /// @brief Benchmarks call the private hot paths directly, see `app/bench/RendererBench.cpp`.
+    friend struct BenchmarkAccess;
+
     /// @brief Description of Hit Point and Object.
     struct HitPayload {
         float HitDist;
         glm::vec3 WorldPos, WorldNormal;
+        /// @brief Index of the sphere or the mesh that was hit.
         int ObjectIdx;
+        int MatIdx;
     };
 
-    glm::vec4 PerPixel(uint32_t x, uint32_t y);
+    /// @brief A `Scene::Meshes` entry with non-empty geometry, as traversed by @ref `TraceRay`.
+    struct MeshInstance {
+        glm::mat4 WorldToObject;
+        /// @brief Inverse transpose of the object to world transform, normals stay perpendicular under scaling.
+        glm::mat3 NormalToWorld;
+        /// @brief Index into `m_GeometryBVHs` and `m_GeometrySoAs`.
+        uint32_t Geometry;
+        uint32_t MeshIdx;
+    };
+
+    /// @brief A path being traced, carried from bounce to bounce.
+    struct PathState {
+        Ray PathRay;
+        glm::vec3 Contribution { 1.0f };
+        glm::vec3 Light { 0.0f };
+        /// @brief Product of the inverse Russian roulette survival probabilities so far.
+        float RouletteWeight = 1.0f;
+        uint32_t Depth = 0;
+        Sampler Rng;
+        uint32_t PixelIdx = 0;
+    };
+
+    /// @brief Counters of one render thread, on their own cache lines so threads never share one.
+    struct alignas(64) ThreadStats {
+        RenderStats Stats;
+    };
+
+    /// @brief Rectangle of pixels `[X0, X1) x [Y0, Y1)`, the unit of work for a render thread.
+    struct Tile {
+        uint32_t X0, Y0, X1, Y1;
+    };
+
+    /// @brief Recreates the thread pool and the Morton ordered tile list when their settings change.
+    /// A new tile list restarts accumulation, as sample counts are kept per tile.
+    void UpdateScheduler(uint32_t width, uint32_t height);
+
+    /// @brief Refills the primary ray cache in parallel when the camera or its version changed.
+    void UpdateRayCache(const Camera& camera);
+
+    /// @brief Rebuilds or refits the BVHs invalidated by @ref `SetScene`.
+    void UpdateAccel();
+    /// @brief Builds the mesh instances and their top level BVH, and the bottom level of every geometry without one.
+    void UpdateMeshAccel();
+
+    /// @brief Counters of the calling render thread, see `RT_STAT`.
+    RenderStats& GetThreadStats() { return m_ThreadStats[ThreadPool::GetThreadIndex()].Stats; }
+
+    /// @brief Samples every tile that is not converged. Always true without adaptive sampling.
+    bool TileNeedsSamples(uint32_t tileIdx) const { return !m_Settings.Adaptive || !m_TileConverged[tileIdx]; }
+
+    /// @brief Traces one sample per pixel of the tile into the accumulation buffers, or takes the wavefront's.
+    void AccumulateTile(uint32_t tileIdx, bool wavefront);
+    /**
+     * @brief Converts the tile's accumulated samples to RGBA8, one row at a time, see @ref `Utils::ResolveRow`.
+     * A tile without samples shows the last preview, or black without one at this size.
+     */
+    void ResolveTile(uint32_t tileIdx, uint32_t* pixels) const;
+
+    /**
+     * @brief Samples tiles from `m_PassTile` on until `Settings::FrameBudgetMs` is spent, then resolves
+     * every tile. A pass after a reset, and every pass without accumulation, marks the tiles stale
+     * instead of clearing them, see `m_TileStale`.
+     */
+    void RenderWithinBudget(uint32_t* pixels);
+
+    /// @brief Block edge for this frame, see `Settings::Preview`.
+    uint32_t UpdatePreviewScale();
+    /// @brief One path per `scale * scale` block, straight to `pixels` and kept in `m_PreviewColors`.
+    /// Empties the tiles, they show the preview until sampled again.
+    void RenderPreview(uint32_t scale, uint32_t* pixels);
+
+    glm::vec3 PerPixel(uint32_t x, uint32_t y);
+
+    /// @brief Primary ray and sampler of pixel `(x, y)` for the current frame.
+    PathState StartPath(uint32_t x, uint32_t y);
+
+    /**
+     * @brief Adds the hit's emission or the sky to the path and scatters it.
+     * False when the path ended, by a miss, `Settings::MaxBounces` or Russian roulette.
+     */
+    bool Bounce(PathState& path, const HitPayload& payload);
+
+    /**
+     * @brief Wavefront mode: traces every pixel of the tiles that need samples, bounce by bounce,
+     * and leaves their radiance in `m_PathRadiance`. Defined in `RendererWavefront.cpp`.
+     */
+    void TraceWavefront();
 
     /**
      * @brief Converts camera ray to a RGBA color. Calls `ClosestHit` or `Miss`.
@@ -49,21 +277,98 @@ private:
      */
     HitPayload TraceRay(const Ray& ray);
     HitPayload ClosestHit(const Ray& ray, float hitDist, int objectIdx);
+    /// @param slot Index into the `m_GeometrySoAs` entry of instance `instanceIdx`.
+    HitPayload ClosestHitTriangle(const Ray& ray, float hitDist, uint32_t instanceIdx, int slot, const glm::vec2& barycentric);
     HitPayload Miss(const Ray& ray);
 
 private:
-    std::shared_ptr<Walnut::Image> m_FinalImage;
+    std::shared_ptr<ImageSink> m_Sink;
+    uint32_t m_Width = 0, m_Height = 0;
     uint32_t* m_ImageData = nullptr;
 
     Settings m_Settings;
-    glm::vec4* m_AccumData = nullptr;
+    /**
+     * @brief Sum of the samples per pixel. Never cleared: the first sample of a tile overwrites its
+     * pixels, so a reset only zeroes `m_TileSamples`.
+     */
+    glm::vec3* m_AccumData = nullptr;
+    /// @brief Sum of squared sample luminance per pixel, for the variance estimate of adaptive sampling.
+    float* m_AccumSqData = nullptr;
+    /// @brief `m_AccumSqData` is only written in adaptive mode, toggling it restarts accumulation.
+    bool m_AccumAdaptive = false;
+    /// @brief Weight of the next sample in the average, back to `1` on every reset.
     uint32_t m_FrameIdx = 1;
+    /// @brief Seeds @ref `Sampler`, counts every sampled frame and survives resets, so that frames rendered
+    /// without accumulation do not repeat the same noise.
+    uint32_t m_SeedIdx = 1;
 
-    const Scene* m_ActiveScene = nullptr;
+    /// @brief Kept alive while rendered, whoever edits the scene publishes a new snapshot instead.
+    std::shared_ptr<const Scene> m_Scene;
     const Camera* m_ActiveCamera = nullptr;
 
-    /// @brief Hold image buffer indices for parallel CPU execution.
-    std::vector<uint32_t> m_ImgHori, m_ImgVert;
+    /// @brief Built over `Scene::Spheres`, traversed by @ref `TraceRay`.
+    BVH m_SphereBVH;
+    std::vector<AABB> m_SphereBounds;
+    /// @brief Spheres in BVH leaf order, for the SIMD leaf kernel.
+    SpheresSoA m_SphereSoA;
+    /// @brief What @ref `UpdateAccel` has to do, collected over the snapshots since the last render.
+    bool m_SpheresRebuild = true;
+    std::vector<uint32_t> m_MovedSpheres;
+    bool m_MeshesRebuild = true;
+
+    /// @brief Bottom level of the mesh BVH, per distinct geometry in the order of @ref `GeometryIndex::Build`.
+    /// Kept for as long as the scene uses the geometry, however its instances move.
+    std::vector<std::shared_ptr<const MeshGeometry>> m_Geometries;
+    std::vector<BVH> m_GeometryBVHs;
+    std::vector<TrianglesSoA> m_GeometrySoAs;
+    /// @brief Top level of the mesh BVH, over the world bounds of `m_Instances`.
+    BVH m_InstanceBVH;
+    std::vector<MeshInstance> m_Instances;
+
+    /// @brief Empty unless `Settings::CacheRayDirections` is on.
+    std::vector<glm::vec3> m_RayDirections;
+    const Camera* m_RayCacheCamera = nullptr;
+    uint32_t m_RayCacheVersion = 0;
+
+    /// @brief Ray queues of the wavefront mode, the live paths and the compacted ones of the next bounce.
+    std::vector<PathState> m_Paths, m_NextPaths;
+    /// @brief Per queued path, its bin for the next bounce or @ref `PathTerminated`.
+    std::vector<uint8_t> m_PathBins;
+    /// @brief Per chunk of the queue and bin, path counts and then scatter offsets.
+    std::vector<uint32_t> m_BinOffsets;
+    /// @brief Radiance of this frame's sample, per pixel, written by the wavefront.
+    std::vector<glm::vec3> m_PathRadiance;
+
+    std::unique_ptr<ThreadPool> m_ThreadPool;
+    std::vector<Tile> m_Tiles;
+    /// @brief Samples accumulated in each tile, pixels of a tile always share their sample count.
+    std::vector<uint32_t> m_TileSamples;
+    /// @brief Per tile, not `std::vector<bool>`, so render threads can write their own tile's flag.
+    std::vector<uint8_t> m_TileConverged;
+    /// @brief Per tile, its samples are from before the current pass began and are shown until its next
+    /// sample replaces them.
+    std::vector<uint8_t> m_TileStale;
+    uint32_t m_TileSize = 0, m_TilesWidth = 0, m_TilesHeight = 0;
+
+    /// @brief Budgeted rendering: first tile of the current pass, tiles done since, and the measured wall
+    /// time per tile.
+    uint32_t m_PassStart = 0, m_PassTile = 0;
+    float m_TileCostMs = 0.0f;
+    float m_ResolveMs = 0.0f;
+
+    uint32_t m_PreviewScale = 1;
+    bool m_PreviewRestart = true;
+    /// @brief Linear radiance per block of the last preview, `m_PreviewBlock` pixels wide. Empty without
+    /// one at this size.
+    std::vector<glm::vec3> m_PreviewColors;
+    uint32_t m_PreviewBlock = 1;
+    /// @brief Estimated time of a full resolution frame, measured from previews scaled by their block area.
+    /// Unknown before the first frame, which therefore starts at the coarsest preview.
+    float m_FullFrameMs = std::numeric_limits<float>::max();
+
+    /// @brief Per thread of the pool, summed into `m_Stats` after every frame.
+    std::vector<ThreadStats> m_ThreadStats;
+    RenderStats m_Stats;
 };
 
 #endif // RENDERER_H
@@ -0,0 +1,122 @@
+// Wavefront integrator: every path of the frame advances one bounce per pass over a shared ray
+// queue. Terminated paths are compacted out between passes and the survivors are binned by
+// direction, so neighbouring rays in the queue traverse the same part of the BVH.
+
+#include <algorithm> // min
+#include <utility> // swap
+
+#include "Renderer.h"
+#include "Walnut/Profiler.h"
+
+namespace {
+
+/// @brief Paths traced by one task, also the granularity of the compaction.
+constexpr uint32_t ChunkSize = 1024;
+
+/// @brief Direction octants, one bin when sorting is off.
+constexpr uint32_t BinCount = 8;
+constexpr uint8_t PathTerminated = 0xff;
+
+uint8_t DirectionOctant(const glm::vec3& dir)
+{
+    return (uint8_t)((dir.x < 0.0f) | ((dir.y < 0.0f) << 1) | ((dir.z < 0.0f) << 2));
+}
+
+} // namespace
+
+void Renderer::TraceWavefront()
+{
+    WL_PROFILE_SCOPE("Wavefront::Trace");
+
+    uint32_t wt = m_Width, ht = m_Height;
+
+    m_PathRadiance.resize((size_t)wt * ht);
+
+    // Queue slots of each tile's pixels, so the tiles can be filled in parallel.
+    std::vector<uint32_t> tileOffsets(m_Tiles.size() + 1, 0);
+    for (uint32_t i = 0; i < m_Tiles.size(); i++) {
+        const auto& tile = m_Tiles[i];
+        uint32_t tilePixels = TileNeedsSamples(i) ? (tile.X1 - tile.X0) * (tile.Y1 - tile.Y0) : 0;
+        tileOffsets[i + 1] = tileOffsets[i] + tilePixels;
+    }
+
+    uint32_t pathCount = tileOffsets.back();
+    m_Paths.resize(pathCount);
+    m_NextPaths.resize(pathCount);
+    m_PathBins.resize(pathCount);
+
+    m_ThreadPool->ParallelFor((uint32_t)m_Tiles.size(), [&](uint32_t tileIdx) {
+        if (!TileNeedsSamples(tileIdx)) {
+            return;
+        }
+
+        WL_PROFILE_SCOPE("Wavefront::StartPaths");
+
+        const auto& tile = m_Tiles[tileIdx];
+        uint32_t slot = tileOffsets[tileIdx];
+
+        for (uint32_t y = tile.Y0; y < tile.Y1; y++) {
+            for (uint32_t x = tile.X0; x < tile.X1; x++) {
+                m_Paths[slot++] = StartPath(x, y);
+            }
+        }
+    });
+
+    const uint32_t bins = m_Settings.SortRays ? BinCount : 1;
+
+    // `Bounce` ends every path at `Settings::MaxBounces`, so the queue drains.
+    while (pathCount > 0) {
+        uint32_t chunkCount = (pathCount + ChunkSize - 1) / ChunkSize;
+        m_BinOffsets.assign((size_t)chunkCount * bins, 0);
+
+        // Trace and shade, then count the survivors of every chunk per bin.
+        m_ThreadPool->ParallelFor(chunkCount, [&](uint32_t chunkIdx) {
+            WL_PROFILE_SCOPE("Wavefront::Bounce");
+
+            uint32_t first = chunkIdx * ChunkSize, last = std::min(pathCount, first + ChunkSize);
+            uint32_t* counts = &m_BinOffsets[(size_t)chunkIdx * bins];
+
+            for (uint32_t i = first; i < last; i++) {
+                auto& path = m_Paths[i];
+
+                if (!Bounce(path, TraceRay(path.PathRay))) {
+                    m_PathRadiance[path.PixelIdx] = path.Light;
+                    m_PathBins[i] = PathTerminated;
+                    continue;
+                }
+
+                uint8_t bin = bins > 1 ? DirectionOctant(path.PathRay.Direction) : 0;
+                m_PathBins[i] = bin;
+                counts[bin]++;
+            }
+        });
+
+        // Exclusive scan, bin major: all chunks' paths of bin 0 first, each chunk in queue order.
+        uint32_t survivors = 0;
+        for (uint32_t bin = 0; bin < bins; bin++) {
+            for (uint32_t chunkIdx = 0; chunkIdx < chunkCount; chunkIdx++) {
+                uint32_t& offset = m_BinOffsets[(size_t)chunkIdx * bins + bin];
+                uint32_t count = offset;
+                offset = survivors;
+                survivors += count;
+            }
+        }
+
+        // Stable scatter keeps paths of nearby pixels next to each other within a bin.
+        m_ThreadPool->ParallelFor(chunkCount, [&](uint32_t chunkIdx) {
+            WL_PROFILE_SCOPE("Wavefront::Compact");
+
+            uint32_t first = chunkIdx * ChunkSize, last = std::min(pathCount, first + ChunkSize);
+            uint32_t* offsets = &m_BinOffsets[(size_t)chunkIdx * bins];
+
+            for (uint32_t i = first; i < last; i++) {
+                if (m_PathBins[i] != PathTerminated) {
+                    m_NextPaths[offsets[m_PathBins[i]]++] = m_Paths[i];
+                }
+            }
+        });
+
+        std::swap(m_Paths, m_NextPaths);
+        pathCount = survivors;
+    }
+}
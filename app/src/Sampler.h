@@ -0,0 +1,86 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/**
+ * @brief PCG32 random generator (O'Neill, pcg-random.org), 16 bytes of state.
+ * Seeded from the pixel and frame index, so a sample does not depend on which thread renders it
+ * and neighbouring pixels or frames get uncorrelated sequences.
+ */
+class Sampler {
+public:
+    Sampler() = default;
+    Sampler(uint32_t pixelIdx, uint32_t frameIdx)
+    {
+        uint64_t seed = ((uint64_t)frameIdx << 32) | pixelIdx;
+
+        // pcg32_srandom: stream and start state both derived from the scrambled seed.
+        m_Inc = (SplitMix64(seed ^ 0xda3e39cb94b95bdbull) << 1) | 1;
+        UInt();
+        m_State += SplitMix64(seed);
+        UInt();
+    }
+
+    uint32_t UInt()
+    {
+        uint64_t old = m_State;
+        m_State = old * 6364136223846793005ull + m_Inc;
+
+        auto xorShifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        auto rot = (uint32_t)(old >> 59);
+        return (xorShifted >> rot) | (xorShifted << ((~rot + 1) & 31));
+    }
+
+    /// @brief Uniform in `[0, 1)`, top 24 bits so every value is exactly representable.
+    float Float()
+    {
+        return (float)(UInt() >> 8) * 0x1p-24f;
+    }
+
+    /// @brief Uniform direction, sampled by area: `z` is uniform in `[-1, 1]` (Archimedes).
+    glm::vec3 OnUnitSphere()
+    {
+        float z = 1.0f - 2.0f * Float();
+        float r = glm::sqrt(glm::max(0.0f, 1.0f - z * z));
+        float phi = 2.0f * Pi * Float();
+
+        return { r * glm::cos(phi), r * glm::sin(phi), z };
+    }
+
+    /// @brief Uniform direction on the hemisphere around `normal`.
+    glm::vec3 OnHemisphere(const glm::vec3& normal)
+    {
+        glm::vec3 dir = OnUnitSphere();
+        return glm::dot(dir, normal) < 0.0f ? -dir : dir;
+    }
+
+    /// @brief Cosine weighted direction around unit `normal`, i.e. an ideal diffuse bounce.
+    glm::vec3 CosineHemisphere(const glm::vec3& normal)
+    {
+        // Offsetting a unit sphere by the normal gives a cosine distribution on the hemisphere.
+        glm::vec3 dir = normal + OnUnitSphere();
+        float len2 = glm::dot(dir, dir);
+
+        return len2 > 1e-8f ? dir / glm::sqrt(len2) : normal;
+    }
+
+private:
+    static uint64_t SplitMix64(uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static constexpr float Pi = 3.14159265358979323846f;
+
+private:
+    uint64_t m_State = 0;
+    uint64_t m_Inc = 1;
+};
+
+#endif // SAMPLER_H
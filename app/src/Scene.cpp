@@ -0,0 +1,102 @@
+#include "Scene.h"
+
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath> // isfinite
+#include <unordered_map>
+
+glm::mat4 Mesh::GetTransform() const
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), Offset);
+    transform = glm::rotate(transform, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    transform = glm::rotate(transform, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    transform = glm::rotate(transform, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    return glm::scale(transform, glm::vec3(Scale));
+}
+
+GeometryIndex GeometryIndex::Build(const std::vector<Mesh>& meshes)
+{
+    GeometryIndex index;
+    index.OfMesh.reserve(meshes.size());
+
+    std::unordered_map<const MeshGeometry*, uint32_t> known;
+    for (auto& mesh : meshes) {
+        auto [it, inserted] = known.try_emplace(mesh.Geometry.get(), (uint32_t)index.Geometries.size());
+        if (inserted) {
+            index.Geometries.push_back(mesh.Geometry);
+        }
+        index.OfMesh.push_back(it->second);
+    }
+    return index;
+}
+
+std::string Scene::Validate() const
+{
+    auto validMaterial = [this](int idx) { return idx >= 0 && idx < (int)Materials.size(); };
+    auto finite = [](const glm::vec3& v) { return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z); };
+
+    for (size_t i = 0; i < Materials.size(); i++) {
+        auto& material = Materials[i];
+        if (!finite(material.Albedo) || !finite(material.EmissionColor) || !std::isfinite(material.Roughness)
+            || !std::isfinite(material.Metallic) || !std::isfinite(material.EmissionPower)) {
+            return fmt::format("material {} has a non-finite value", i);
+        }
+    }
+
+    for (size_t i = 0; i < Spheres.size(); i++) {
+        auto& sphere = Spheres[i];
+        if (!validMaterial(sphere.MatIdx)) {
+            return fmt::format("sphere {} has no material {}", i, sphere.MatIdx);
+        }
+        // Would end up in the BVH bounds, and NaN radiance never leaves the accumulated image.
+        if (!finite(sphere.Pos)) {
+            return fmt::format("sphere {} has a non-finite position", i);
+        }
+        if (!std::isfinite(sphere.Radius) || sphere.Radius <= 0.0f) {
+            return fmt::format("sphere {} has invalid radius {}", i, sphere.Radius);
+        }
+    }
+
+    for (size_t i = 0; i < Meshes.size(); i++) {
+        auto& mesh = Meshes[i];
+        if (!validMaterial(mesh.MatIdx)) {
+            return fmt::format("mesh {} has no material {}", i, mesh.MatIdx);
+        }
+        // A zero scale has no inverse, the instance transforms would be NaN.
+        if (!std::isfinite(mesh.Scale) || mesh.Scale == 0.0f) {
+            return fmt::format("mesh {} has invalid scale {}", i, mesh.Scale);
+        }
+        if (!finite(mesh.Rotation) || !finite(mesh.Offset)) {
+            return fmt::format("mesh {} has a non-finite rotation or offset", i);
+        }
+    }
+
+    return {};
+}
+
+SceneChanges SceneChanges::Diff(const Scene& from, const Scene& to)
+{
+    SceneChanges changes;
+    changes.Shading = from.Materials != to.Materials;
+
+    changes.SphereCount = from.Spheres.size() != to.Spheres.size();
+    for (uint32_t i = 0; i < std::min(from.Spheres.size(), to.Spheres.size()); i++) {
+        auto &a = from.Spheres[i], &b = to.Spheres[i];
+        if (a.Pos != b.Pos || a.Radius != b.Radius) {
+            changes.MovedSpheres.push_back(i);
+        }
+        changes.Shading |= a.MatIdx != b.MatIdx;
+    }
+
+    // A reordered mesh keeps its geometry but changes the triangle order of the BVH.
+    changes.Meshes = from.Meshes.size() != to.Meshes.size();
+    for (size_t i = 0; i < std::min(from.Meshes.size(), to.Meshes.size()); i++) {
+        auto &a = from.Meshes[i], &b = to.Meshes[i];
+        changes.Meshes |= a.Geometry != b.Geometry || a.Scale != b.Scale || a.Rotation != b.Rotation || a.Offset != b.Offset;
+        changes.Shading |= a.MatIdx != b.MatIdx;
+    }
+
+    return changes;
+}
@@ -2,6 +2,11 @@
 #define SCENE_H
 
 #include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "Color.h"
@@ -15,17 +20,88 @@ struct Material {
     float EmissionPower = 0.0f;
 
     auto GetEmission() const { return EmissionColor * EmissionPower; }
+
+    bool operator==(const Material&) const = default;
 };
 
 struct Sphere {
     glm::vec3 Pos { 0.0f };
     float Radius = 0.5f;
     int MatIdx = 0;
+
+    bool operator==(const Sphere&) const = default;
+};
+
+/// @brief Indexed triangles, vertices in object space. Placed in the world by each @ref `Mesh` using it.
+struct MeshGeometry {
+    std::vector<glm::vec3> Positions;
+    /// @brief Per vertex, parallel to `Positions`. Empty for flat shading.
+    std::vector<glm::vec3> Normals;
+    /// @brief Three per triangle, into `Positions` and `Normals`.
+    std::vector<uint32_t> Indices;
+
+    uint32_t GetTriangleCount() const { return (uint32_t)(Indices.size() / 3); }
+};
+
+/// @brief An instance of a geometry, any number of meshes may share one.
+struct Mesh {
+    /**
+     * @brief Immutable and shared by every copy of the scene and every mesh placing it, so copies and
+     * instances stay cheap however large the geometry. Changing it means replacing it, which
+     * @ref `SceneChanges::Diff` picks up.
+     */
+    std::shared_ptr<const MeshGeometry> Geometry = std::make_shared<const MeshGeometry>();
+    int MatIdx = 0;
+
+    /// @brief File the mesh was read from, empty for generated meshes. Scene files refer to it.
+    std::filesystem::path Source;
+    /// @brief Object to world transform: scaled, rotated by `Rotation` degrees about X, Y then Z, then offset.
+    float Scale = 1.0f;
+    glm::vec3 Rotation { 0.0f };
+    glm::vec3 Offset { 0.0f };
+
+    glm::mat4 GetTransform() const;
+    uint32_t GetTriangleCount() const { return Geometry->GetTriangleCount(); }
+};
+
+/// @brief The distinct geometries of a list of meshes, in order of first use.
+struct GeometryIndex {
+    std::vector<std::shared_ptr<const MeshGeometry>> Geometries;
+    /// @brief Per mesh, the index of its geometry in `Geometries`.
+    std::vector<uint32_t> OfMesh;
+
+    static GeometryIndex Build(const std::vector<Mesh>& meshes);
 };
 
 struct Scene {
     std::vector<Sphere> Spheres;
+    std::vector<Mesh> Meshes;
     std::vector<Material> Materials;
+
+    /**
+     * @brief Why the renderer cannot take the scene, empty if it can. It indexes materials without
+     * checks, inverts mesh transforms and builds BVHs over the spheres, and a single NaN sample stays
+     * in the accumulated image. Scenes read from files are checked first, and saved ones.
+     */
+    std::string Validate() const;
+};
+
+/// @brief What differs between two versions of a scene, to invalidate no more of the renderer than needed.
+struct SceneChanges {
+    /// @brief Spheres added or removed, their BVH is rebuilt.
+    bool SphereCount = false;
+    /// @brief Spheres moved or resized, by index. Their bounds are updated and the BVH refit.
+    std::vector<uint32_t> MovedSpheres;
+    /// @brief Meshes added, removed, reordered, moved or given other geometry. The top level of their BVH
+    /// is rebuilt, and the bottom level of geometry not in the previous scene.
+    bool Meshes = false;
+    /// @brief Materials or material indices, only the accumulated image is stale.
+    bool Shading = false;
+
+    bool Any() const { return SphereCount || !MovedSpheres.empty() || Meshes || Shading; }
+
+    /// @brief Compares objects and materials by value, mesh geometry by identity.
+    static SceneChanges Diff(const Scene& from, const Scene& to);
 };
 
 #endif // SCENE_H
@@ -0,0 +1,332 @@
+#include "SceneCache.h"
+
+#include <fmt/format.h>
+
+#include <algorithm> // max
+#include <cstring> // memcmp, memcpy
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// File layout: `FileHeader`, `SectionHeader` table, then every section at a 16 byte aligned offset.
+
+constexpr char Magic[4] = { 'R', 'T', 'S', 'C' };
+constexpr uint32_t ByteOrderMark = 0x01020304;
+constexpr uint64_t SectionAlignment = 16;
+
+enum class SectionType : uint32_t {
+    Materials,
+    Spheres,
+    /// @brief One `CachedMesh` per mesh, also defines the mesh count.
+    Meshes,
+    GeometryPositions,
+    GeometryNormals,
+    GeometryIndices,
+    SphereNodes,
+    SpherePrims,
+    GeometryNodes,
+    GeometryPrims,
+};
+
+struct FileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t SectionCount;
+    /// @brief Written natively, reads back differently on a machine of the other endianness.
+    uint32_t ByteOrder;
+};
+
+struct SectionHeader {
+    SectionType Type;
+    /// @brief Geometry of the per-geometry sections, `0` otherwise.
+    uint32_t Index;
+    uint64_t Offset;
+    uint64_t Size;
+};
+
+/// @brief A mesh without its geometry, which is stored once however many meshes share it.
+struct CachedMesh {
+    uint32_t Geometry;
+    int32_t MatIdx;
+    float Scale;
+    glm::vec3 Rotation, Offset;
+};
+
+static_assert(std::is_trivially_copyable_v<Material>);
+static_assert(std::is_trivially_copyable_v<Sphere>);
+static_assert(std::is_trivially_copyable_v<BVHNode>);
+static_assert(std::is_trivially_copyable_v<glm::vec3>);
+
+/// @brief Collects the sections first, so the table can be written with final offsets.
+class Writer {
+public:
+    template <typename T>
+    void Add(SectionType type, uint32_t index, const std::vector<T>& data)
+    {
+        m_Sections.push_back({ SectionHeader { type, index, 0, data.size() * sizeof(T) }, data.data() });
+    }
+
+    bool Write(const std::filesystem::path& path)
+    {
+        uint64_t offset = sizeof(FileHeader) + m_Sections.size() * sizeof(SectionHeader);
+        for (auto& [header, data] : m_Sections) {
+            offset = (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+            header.Offset = offset;
+            offset += header.Size;
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+
+        FileHeader fileHeader { {}, SceneCache::Version, (uint32_t)m_Sections.size(), ByteOrderMark };
+        std::memcpy(fileHeader.Magic, Magic, sizeof(Magic));
+        file.write((const char*)&fileHeader, sizeof(fileHeader));
+
+        for (auto& [header, data] : m_Sections) {
+            file.write((const char*)&header, sizeof(header));
+        }
+
+        for (auto& [header, data] : m_Sections) {
+            const char padding[SectionAlignment] = {};
+            file.write(padding, (std::streamsize)(header.Offset - (uint64_t)file.tellp()));
+            file.write((const char*)data, (std::streamsize)header.Size);
+        }
+
+        return (bool)file;
+    }
+
+private:
+    struct Section {
+        SectionHeader Header;
+        const void* Data;
+    };
+
+    std::vector<Section> m_Sections;
+};
+
+/// @brief Reads a section straight into `out`, one read per section. False if it lies outside the file.
+template <typename T>
+bool ReadSection(std::ifstream& file, uint64_t fileSize, const SectionHeader& section, std::vector<T>& out)
+{
+    if (section.Offset > fileSize || section.Size > fileSize - section.Offset || section.Size % sizeof(T) != 0) {
+        return false;
+    }
+
+    out.resize(section.Size / sizeof(T));
+    file.seekg((std::streamoff)section.Offset);
+    file.read((char*)out.data(), (std::streamsize)section.Size);
+    return (bool)file;
+}
+
+/// @brief Indices inside their buffers. The renderer does not check again.
+bool ValidateGeometry(const MeshGeometry& geometry)
+{
+    if (geometry.Indices.size() % 3 != 0 || (!geometry.Normals.empty() && geometry.Normals.size() != geometry.Positions.size())) {
+        return false;
+    }
+
+    for (uint32_t idx : geometry.Indices) {
+        if (idx >= geometry.Positions.size()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool SceneCache::Save(const std::filesystem::path& path, const Scene& scene, const BVH& sphereBVH, std::span<const BVH> geometryBVHs)
+{
+    auto index = GeometryIndex::Build(scene.Meshes);
+    if (geometryBVHs.size() != index.Geometries.size()) {
+        fmt::println(stderr, "Error: {} geometry BVHs for {} geometries, not writing scene cache '{}'",
+            geometryBVHs.size(), index.Geometries.size(), path.string());
+        return false;
+    }
+
+    Writer writer;
+    writer.Add(SectionType::Materials, 0, scene.Materials);
+    writer.Add(SectionType::Spheres, 0, scene.Spheres);
+
+    std::vector<CachedMesh> meshes;
+    for (uint32_t i = 0; i < scene.Meshes.size(); i++) {
+        auto& mesh = scene.Meshes[i];
+        meshes.push_back({ index.OfMesh[i], mesh.MatIdx, mesh.Scale, mesh.Rotation, mesh.Offset });
+    }
+    writer.Add(SectionType::Meshes, 0, meshes);
+
+    for (uint32_t i = 0; i < index.Geometries.size(); i++) {
+        writer.Add(SectionType::GeometryPositions, i, index.Geometries[i]->Positions);
+        writer.Add(SectionType::GeometryNormals, i, index.Geometries[i]->Normals);
+        writer.Add(SectionType::GeometryIndices, i, index.Geometries[i]->Indices);
+        writer.Add(SectionType::GeometryNodes, i, geometryBVHs[i].GetNodes());
+        writer.Add(SectionType::GeometryPrims, i, geometryBVHs[i].GetPrimIndices());
+    }
+
+    writer.Add(SectionType::SphereNodes, 0, sphereBVH.GetNodes());
+    writer.Add(SectionType::SpherePrims, 0, sphereBVH.GetPrimIndices());
+
+    if (!writer.Write(path)) {
+        fmt::println(stderr, "Error: could not write scene cache '{}'", path.string());
+        return false;
+    }
+    return true;
+}
+
+std::optional<SceneCache::CachedScene> SceneCache::Load(const std::filesystem::path& path)
+{
+    std::error_code err;
+    uint64_t fileSize = std::filesystem::file_size(path, err);
+    std::ifstream file(path, std::ios::binary);
+    if (err || !file) {
+        fmt::println(stderr, "Error: could not open scene cache '{}'", path.string());
+        return std::nullopt;
+    }
+
+    auto damaged = [&path]() {
+        fmt::println(stderr, "Error: scene cache '{}' is damaged", path.string());
+        return std::nullopt;
+    };
+
+    FileHeader header;
+    if (fileSize < sizeof(header) || !file.read((char*)&header, sizeof(header))) {
+        return damaged();
+    }
+
+    if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.ByteOrder != ByteOrderMark) {
+        fmt::println(stderr, "Error: '{}' is not a scene cache of this platform", path.string());
+        return std::nullopt;
+    }
+
+    if (header.Version != Version) {
+        fmt::println(stderr, "Error: scene cache '{}' has version {}, expected {}", path.string(), header.Version, Version);
+        return std::nullopt;
+    }
+
+    if ((fileSize - sizeof(header)) / sizeof(SectionHeader) < header.SectionCount) {
+        return damaged();
+    }
+
+    std::vector<SectionHeader> sections(header.SectionCount);
+    if (!file.read((char*)sections.data(), (std::streamsize)(sections.size() * sizeof(SectionHeader)))) {
+        return damaged();
+    }
+
+    CachedScene cached;
+    auto& scene = cached.Contents;
+    std::vector<BVHNode> sphereNodes;
+    std::vector<uint32_t> spherePrims;
+    // Filled before they are shared with the meshes.
+    std::vector<MeshGeometry> geometries;
+    std::vector<std::vector<BVHNode>> geometryNodes;
+    std::vector<std::vector<uint32_t>> geometryPrims;
+
+    // Meshes first, they define the geometry count and the per-geometry sections may come in any order.
+    std::vector<CachedMesh> meshes;
+    for (auto& section : sections) {
+        if (section.Type == SectionType::Meshes && !ReadSection(file, fileSize, section, meshes)) {
+            return damaged();
+        }
+    }
+
+    size_t geometryCount = 0;
+    for (auto& mesh : meshes) {
+        geometryCount = std::max(geometryCount, (size_t)mesh.Geometry + 1);
+    }
+    // Every geometry comes with its own sections, don't allocate for a corrupt index.
+    if (geometryCount > sections.size()) {
+        return damaged();
+    }
+    geometries.resize(geometryCount);
+    geometryNodes.resize(geometryCount);
+    geometryPrims.resize(geometryCount);
+
+    for (auto& section : sections) {
+        bool perGeometry = section.Type == SectionType::GeometryPositions || section.Type == SectionType::GeometryNormals
+            || section.Type == SectionType::GeometryIndices || section.Type == SectionType::GeometryNodes
+            || section.Type == SectionType::GeometryPrims;
+        if (perGeometry && section.Index >= geometryCount) {
+            return damaged();
+        }
+
+        bool ok = true;
+        switch (section.Type) {
+        case SectionType::Materials:
+            ok = ReadSection(file, fileSize, section, scene.Materials);
+            break;
+        case SectionType::Spheres:
+            ok = ReadSection(file, fileSize, section, scene.Spheres);
+            break;
+        case SectionType::Meshes:
+            break;
+        case SectionType::GeometryPositions:
+            ok = ReadSection(file, fileSize, section, geometries[section.Index].Positions);
+            break;
+        case SectionType::GeometryNormals:
+            ok = ReadSection(file, fileSize, section, geometries[section.Index].Normals);
+            break;
+        case SectionType::GeometryIndices:
+            ok = ReadSection(file, fileSize, section, geometries[section.Index].Indices);
+            break;
+        case SectionType::SphereNodes:
+            ok = ReadSection(file, fileSize, section, sphereNodes);
+            break;
+        case SectionType::SpherePrims:
+            ok = ReadSection(file, fileSize, section, spherePrims);
+            break;
+        case SectionType::GeometryNodes:
+            ok = ReadSection(file, fileSize, section, geometryNodes[section.Index]);
+            break;
+        case SectionType::GeometryPrims:
+            ok = ReadSection(file, fileSize, section, geometryPrims[section.Index]);
+            break;
+        default:
+            // Unknown sections are skipped.
+            break;
+        }
+
+        if (!ok) {
+            return damaged();
+        }
+    }
+
+    std::vector<std::shared_ptr<const MeshGeometry>> shared;
+    cached.GeometryBVHs.resize(geometryCount);
+
+    for (size_t i = 0; i < geometryCount; i++) {
+        uint32_t triangleCount = geometries[i].GetTriangleCount();
+        bool valid = ValidateGeometry(geometries[i])
+            && cached.GeometryBVHs[i].Assign(std::move(geometryNodes[i]), std::move(geometryPrims[i]), triangleCount);
+        if (!valid) {
+            return damaged();
+        }
+
+        shared.push_back(std::make_shared<const MeshGeometry>(std::move(geometries[i])));
+    }
+
+    for (auto& cachedMesh : meshes) {
+        auto& mesh = scene.Meshes.emplace_back();
+        mesh.Geometry = shared[cachedMesh.Geometry];
+        mesh.MatIdx = cachedMesh.MatIdx;
+        mesh.Scale = cachedMesh.Scale;
+        mesh.Rotation = cachedMesh.Rotation;
+        mesh.Offset = cachedMesh.Offset;
+    }
+
+    // Written from a valid scene, so a failure means the file was damaged or tampered with.
+    if (auto error = scene.Validate(); !error.empty()) {
+        fmt::println(stderr, "Error: scene cache '{}' is damaged, {}", path.string(), error);
+        return std::nullopt;
+    }
+
+    if (!cached.SphereBVH.Assign(std::move(sphereNodes), std::move(spherePrims), scene.Spheres.size())) {
+        return damaged();
+    }
+
+    return cached;
+}
@@ -0,0 +1,244 @@
+#include "SceneFile.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h> // join
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MeshLoader.h"
+
+namespace {
+
+using Json = nlohmann::json;
+
+glm::vec3 GetVec3(const Json& object, const char* key, const glm::vec3& fallback)
+{
+    auto it = object.find(key);
+    if (it == object.end()) {
+        return fallback;
+    }
+
+    auto values = it->get<std::array<float, 3>>();
+    return { values[0], values[1], values[2] };
+}
+
+/// @brief Scene with mesh descriptions only, the geometry is read by @ref `LoadGeometry`.
+std::optional<Scene> Parse(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        fmt::println(stderr, "Error: could not open '{}'", path.string());
+        return std::nullopt;
+    }
+
+    Scene scene;
+
+    // The library reports errors with exceptions, they end here.
+    try {
+        auto json = Json::parse(file, nullptr, true, true);
+        if (!json.is_object()) {
+            fmt::println(stderr, "Error: {}: expected an object", path.string());
+            return std::nullopt;
+        }
+
+        for (const Material defaults; auto& entry : json.value("materials", Json::array())) {
+            scene.Materials.emplace_back(Material {
+                .Albedo = GetVec3(entry, "albedo", defaults.Albedo),
+                .Roughness = entry.value("roughness", defaults.Roughness),
+                .Metallic = entry.value("metallic", defaults.Metallic),
+                .EmissionColor = GetVec3(entry, "emissionColor", defaults.EmissionColor),
+                .EmissionPower = entry.value("emissionPower", defaults.EmissionPower),
+            });
+        }
+
+        for (const Sphere defaults; auto& entry : json.value("spheres", Json::array())) {
+            scene.Spheres.emplace_back(Sphere {
+                .Pos = GetVec3(entry, "position", defaults.Pos),
+                .Radius = entry.value("radius", defaults.Radius),
+                .MatIdx = entry.value("material", defaults.MatIdx),
+            });
+        }
+
+        auto directory = std::filesystem::absolute(path).parent_path();
+        for (auto& entry : json.value("meshes", Json::array())) {
+            Mesh mesh;
+            mesh.Source = (directory / entry.at("file").get<std::string>()).lexically_normal();
+            mesh.Scale = entry.value("scale", mesh.Scale);
+            mesh.Rotation = GetVec3(entry, "rotation", mesh.Rotation);
+            mesh.Offset = GetVec3(entry, "offset", mesh.Offset);
+            mesh.MatIdx = entry.value("material", mesh.MatIdx);
+
+            scene.Meshes.push_back(std::move(mesh));
+        }
+    } catch (const Json::exception& e) {
+        fmt::println(stderr, "Error: {}: {}", path.string(), e.what());
+        return std::nullopt;
+    }
+
+    if (auto error = scene.Validate(); !error.empty()) {
+        fmt::println(stderr, "Error: {}: {}", path.string(), error);
+        return std::nullopt;
+    }
+
+    return scene;
+}
+
+using GeometryByFile = std::map<std::filesystem::path, std::shared_ptr<const MeshGeometry>>;
+
+/**
+ * @brief Reads the files of parsed meshes, each only once: meshes of the same file are instances of
+ * one geometry. `known` starts with geometry already in memory and collects every file read.
+ */
+bool LoadGeometry(std::vector<Mesh>& meshes, GeometryByFile& known)
+{
+    for (auto& mesh : meshes) {
+        auto& geometry = known[mesh.Source];
+        if (!geometry) {
+            auto loaded = MeshLoader::Load(mesh.Source);
+            if (!loaded) {
+                return false;
+            }
+            geometry = std::make_shared<const MeshGeometry>(std::move(*loaded));
+        }
+
+        mesh.Geometry = geometry;
+    }
+
+    return true;
+}
+
+/// @brief `{}` formats floats as the shortest string that reads back exactly, so files round-trip.
+std::string FormatVec3(const glm::vec3& v)
+{
+    return fmt::format("[{}, {}, {}]", v.x, v.y, v.z);
+}
+
+} // namespace
+
+std::optional<Scene> SceneFile::Load(const std::filesystem::path& path)
+{
+    auto scene = Parse(path);
+    if (!scene) {
+        return std::nullopt;
+    }
+
+    GeometryByFile known;
+    if (!LoadGeometry(scene->Meshes, known)) {
+        return std::nullopt;
+    }
+
+    return scene;
+}
+
+bool SceneFile::Save(const std::filesystem::path& path, const Scene& scene)
+{
+    // JSON has no NaN or infinity, and `Load` would reject such a scene anyway.
+    if (auto error = scene.Validate(); !error.empty()) {
+        fmt::println(stderr, "Error: not saving '{}', {}", path.string(), error);
+        return false;
+    }
+
+    // Written by hand rather than dumped, to keep one object per line.
+    std::vector<std::string> materials, spheres, meshes;
+
+    for (auto& material : scene.Materials) {
+        materials.push_back(fmt::format(
+            R"({{ "albedo": {}, "roughness": {}, "metallic": {}, "emissionColor": {}, "emissionPower": {} }})",
+            FormatVec3(material.Albedo), material.Roughness, material.Metallic,
+            FormatVec3(material.EmissionColor), material.EmissionPower));
+    }
+
+    for (auto& sphere : scene.Spheres) {
+        spheres.push_back(fmt::format(R"({{ "position": {}, "radius": {}, "material": {} }})",
+            FormatVec3(sphere.Pos), sphere.Radius, sphere.MatIdx));
+    }
+
+    auto directory = std::filesystem::absolute(path).parent_path();
+    for (size_t i = 0; i < scene.Meshes.size(); i++) {
+        auto& mesh = scene.Meshes[i];
+        if (mesh.Source.empty()) {
+            fmt::println(stderr, "Warning: mesh {} was not read from a file and is not saved", i);
+            continue;
+        }
+
+        // Dumped for the quoting and escaping of the path.
+        auto file = Json(std::filesystem::absolute(mesh.Source).lexically_proximate(directory).generic_string()).dump();
+        meshes.push_back(fmt::format(R"({{ "file": {}, "scale": {}, "rotation": {}, "offset": {}, "material": {} }})",
+            file, mesh.Scale, FormatVec3(mesh.Rotation), FormatVec3(mesh.Offset), mesh.MatIdx));
+    }
+
+    auto section = [](const char* name, const std::vector<std::string>& entries) {
+        if (entries.empty()) {
+            return fmt::format("    \"{}\": []", name);
+        }
+        return fmt::format("    \"{}\": [\n        {}\n    ]", name, fmt::join(entries, ",\n        "));
+    };
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        fmt::println(stderr, "Error: could not open '{}' for writing", path.string());
+        return false;
+    }
+
+    file << fmt::format("{{\n{},\n{},\n{}\n}}\n",
+        section("materials", materials), section("spheres", spheres), section("meshes", meshes));
+
+    return file.good();
+}
+
+std::optional<SceneChanges> SceneFile::Reload(const std::filesystem::path& path, Scene& scene)
+{
+    auto updated = Parse(path);
+    if (!updated) {
+        return std::nullopt;
+    }
+
+    // Share the geometry of every file `scene` already uses and read only new ones, whatever the
+    // transforms. `scene` stays intact if a file fails to load.
+    GeometryByFile known;
+    for (auto& mesh : scene.Meshes) {
+        if (!mesh.Source.empty()) {
+            known.try_emplace(mesh.Source, mesh.Geometry);
+        }
+    }
+
+    if (!LoadGeometry(updated->Meshes, known)) {
+        return std::nullopt;
+    }
+
+    auto changes = SceneChanges::Diff(scene, *updated);
+    scene = std::move(*updated);
+    return changes;
+}
+
+SceneFile::Watcher::Watcher(std::filesystem::path path)
+    : m_Path(std::move(path))
+{
+    std::error_code err;
+    m_LastWrite = std::filesystem::last_write_time(m_Path, err);
+}
+
+bool SceneFile::Watcher::Poll()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (m_Path.empty() || now - m_LastPoll < Interval) {
+        return false;
+    }
+    m_LastPoll = now;
+
+    // Editors may replace the file, it can be missing for a moment.
+    std::error_code err;
+    auto lastWrite = std::filesystem::last_write_time(m_Path, err);
+    if (err || lastWrite == m_LastWrite) {
+        return false;
+    }
+
+    m_LastWrite = lastWrite;
+    return true;
+}
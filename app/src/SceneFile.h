@@ -0,0 +1,62 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+
+#include "Scene.h"
+
+/**
+ * @brief Human-editable JSON scene description. Materials and spheres are stored inline, meshes by
+ * file and transform. Meshes of the same file share one geometry, so a file is read once however
+ * often it is placed. Rotations are in degrees about X, Y then Z. Every field is optional and defaults
+ * to the value of the struct, comments are allowed. Errors are printed to `stderr` and return `std::nullopt` or `false`.
+ *
+ * ```
+ * {
+ *     "materials": [ { "albedo": [1, 0, 1], "roughness": 0, "emissionColor": [1, 0.5, 0], "emissionPower": 2 } ],
+ *     "spheres": [ { "position": [0, 0, -3], "radius": 1, "material": 0 } ],
+ *     "meshes": [ { "file": "bunny.ply", "scale": 1, "rotation": [0, 90, 0], "offset": [0, -1, -3], "material": 0 } ]
+ * }
+ * ```
+ */
+namespace SceneFile {
+
+/// @brief Mesh paths are relative to the directory of the scene file.
+std::optional<Scene> Load(const std::filesystem::path& path);
+
+/**
+ * @brief Meshes without a `Mesh::Source` are skipped with a warning. Scenes @ref `Scene::Validate`
+ * rejects are not saved, they would not load back.
+ */
+bool Save(const std::filesystem::path& path, const Scene& scene);
+
+/**
+ * @brief Reads `path` again and updates `scene` in place. Files `scene` already uses are not read
+ * again, their meshes keep sharing the geometry in memory. `scene` is left untouched on errors.
+ */
+std::optional<SceneChanges> Reload(const std::filesystem::path& path, Scene& scene);
+
+/// @brief Polls the modification time of a file, at most every `Interval`, cheap enough to call every frame.
+class Watcher {
+public:
+    static constexpr std::chrono::milliseconds Interval { 250 };
+
+    Watcher() = default;
+    explicit Watcher(std::filesystem::path path);
+
+    const std::filesystem::path& GetPath() const { return m_Path; }
+
+    /// @brief `true` once after each change of the file, never for an empty path.
+    bool Poll();
+
+private:
+    std::filesystem::path m_Path;
+    std::filesystem::file_time_type m_LastWrite {};
+    std::chrono::steady_clock::time_point m_LastPoll {};
+};
+
+} // namespace SceneFile
+
+#endif // SCENE_FILE_H
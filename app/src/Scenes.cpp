@@ -0,0 +1,243 @@
+#include "Scenes.h"
+
+#include <algorithm> // max
+#include <charconv>
+#include <limits>
+#include <cmath>
+#include <random>
+
+#include "Color.h"
+#include "MeshLoader.h"
+#include "SceneFile.h"
+
+/// @brief Scale fitting the largest side of `geometry` to 2 units, and its bottom center, in object space.
+static std::pair<float, glm::vec3> FitOnGround(const MeshGeometry& geometry)
+{
+    glm::vec3 lo { std::numeric_limits<float>::max() }, hi { std::numeric_limits<float>::lowest() };
+    for (auto& pos : geometry.Positions) {
+        lo = glm::min(lo, pos);
+        hi = glm::max(hi, pos);
+    }
+
+    glm::vec3 size = hi - lo;
+    float maxSide = std::max({ size.x, size.y, size.z });
+    float scale = maxSide > 0.0f ? 2.0f / maxSide : 1.0f;
+
+    return { scale, glm::vec3((lo.x + hi.x) * 0.5f, lo.y, (lo.z + hi.z) * 0.5f) };
+}
+
+Scene Scenes::Default()
+{
+    Scene scene;
+
+    // materials
+    {
+        scene.Materials.emplace_back(Material {
+            .Albedo = Color::Magenta,
+            .Roughness = 0.0f,
+        });
+
+        scene.Materials.emplace_back(Material {
+            .Albedo = Color::Sky_950,
+            .Roughness = 0.1f,
+        });
+
+        scene.Materials.emplace_back(Material {
+            .Albedo = Color::Orange_600,
+            .Roughness = 0.1f,
+            .EmissionColor = Color::Orange_600,
+            .EmissionPower = 2.0f });
+    }
+
+    scene.Spheres.emplace_back(Sphere {
+        .Pos = { 0.0f, 0.0f, -3.0f },
+        .Radius = 1.0f,
+        .MatIdx = 0,
+    });
+
+    scene.Spheres.emplace_back(Sphere {
+        .Pos = { 2.0f, 0.0f, -3.0f },
+        .Radius = 1.0f,
+        .MatIdx = 2,
+    });
+
+    scene.Spheres.emplace_back(Sphere {
+        .Pos = { 0.0f, -101.0f, -3.0f },
+        .Radius = 100.0f,
+        .MatIdx = 1,
+    });
+
+    return scene;
+}
+
+Scene Scenes::RandomSpheres(uint32_t count, uint32_t seed)
+{
+    Scene scene;
+
+    scene.Materials.emplace_back(Material { .Albedo = Color::Sky_950 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Red_600 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Green_600 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Blue_600 });
+    scene.Materials.emplace_back(Material {
+        .Albedo = Color::Orange_600,
+        .EmissionColor = Color::Orange_600,
+        .EmissionPower = 2.0f });
+
+    scene.Spheres.emplace_back(Sphere {
+        .Pos = { 0.0f, -101.0f, -3.0f },
+        .Radius = 100.0f,
+        .MatIdx = 0,
+    });
+
+    // Keep the density roughly constant, so larger counts fill a larger volume.
+    float extent = 2.0f * std::cbrt((float)count);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(-extent, extent);
+    std::uniform_real_distribution<float> radius(0.05f, 0.25f);
+    std::uniform_int_distribution<int> material(1, (int)scene.Materials.size() - 1);
+
+    scene.Spheres.reserve(count + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        scene.Spheres.emplace_back(Sphere {
+            .Pos = { pos(rng), std::abs(pos(rng)) - 0.75f, pos(rng) - extent - 3.0f },
+            .Radius = radius(rng),
+            .MatIdx = material(rng),
+        });
+    }
+
+    return scene;
+}
+
+Scene Scenes::WithMesh(MeshGeometry geometry, std::filesystem::path source)
+{
+    Scene scene;
+
+    scene.Materials.emplace_back(Material { .Albedo = Color::Sky_950 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Slate_300 });
+
+    scene.Spheres.emplace_back(Sphere {
+        .Pos = { 0.0f, -101.0f, -3.0f },
+        .Radius = 100.0f,
+        .MatIdx = 0,
+    });
+
+    // Centered where the default spheres are, resting on the ground.
+    auto [scale, pivot] = FitOnGround(geometry);
+
+    scene.Meshes.emplace_back(Mesh {
+        .Geometry = std::make_shared<const MeshGeometry>(std::move(geometry)),
+        .MatIdx = 1,
+        .Source = std::move(source),
+        .Scale = scale,
+        .Offset = glm::vec3(0.0f, -1.0f, -3.0f) - pivot * scale,
+    });
+
+    return scene;
+}
+
+Scene Scenes::Instances(MeshGeometry geometry, uint32_t count, std::filesystem::path source, uint32_t seed)
+{
+    Scene scene;
+
+    scene.Materials.emplace_back(Material { .Albedo = Color::Sky_950 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Slate_300 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Red_600 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Green_600 });
+    scene.Materials.emplace_back(Material { .Albedo = Color::Blue_600 });
+
+    // A flat ground, the ground sphere would curve away under a large grid.
+    MeshGeometry quad;
+    quad.Positions = { { -1.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 1.0f } };
+    quad.Indices = { 0, 1, 2, 0, 2, 3 };
+
+    auto& ground = scene.Meshes.emplace_back();
+    ground.Geometry = std::make_shared<const MeshGeometry>(std::move(quad));
+    ground.MatIdx = 0;
+    ground.Scale = 1000.0f;
+    ground.Offset = { 0.0f, -1.0f, 0.0f };
+
+    auto [scale, pivot] = FitOnGround(geometry);
+    auto shared = std::make_shared<const MeshGeometry>(std::move(geometry));
+
+    // Square grid of 3 unit cells, centered in X and growing away from the camera.
+    constexpr float cellSize = 3.0f;
+    uint32_t side = std::max(1u, (uint32_t)std::ceil(std::sqrt((float)count)));
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+    std::uniform_int_distribution<int> material(1, (int)scene.Materials.size() - 1);
+
+    scene.Meshes.reserve(count + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 cell {
+            ((float)(i % side) - (float)(side - 1) * 0.5f) * cellSize,
+            -1.0f,
+            -3.0f - (float)(i / side) * cellSize,
+        };
+
+        auto& mesh = scene.Meshes.emplace_back(Mesh {
+            .Geometry = shared,
+            .MatIdx = material(rng),
+            .Source = source,
+            .Scale = scale,
+            .Rotation = { 0.0f, angle(rng), 0.0f },
+        });
+
+        // Turned about its bottom center rather than the object's origin.
+        mesh.Offset = cell - glm::vec3(mesh.GetTransform() * glm::vec4(pivot, 1.0f));
+    }
+
+    return scene;
+}
+
+std::optional<Scene> Scenes::FromName(std::string_view name)
+{
+    if (name == "default") {
+        return Default();
+    }
+
+    if (name.ends_with(".json")) {
+        return SceneFile::Load(std::filesystem::path(name));
+    }
+
+    constexpr std::string_view meshPrefix = "mesh:";
+    if (name.starts_with(meshPrefix)) {
+        std::filesystem::path path = name.substr(meshPrefix.size());
+        if (auto geometry = MeshLoader::Load(path)) {
+            return WithMesh(std::move(*geometry), std::move(path));
+        }
+        return std::nullopt;
+    }
+
+    // `instances:<count>:<path>`, the path may contain colons itself.
+    constexpr std::string_view instancesPrefix = "instances:";
+    if (name.starts_with(instancesPrefix)) {
+        uint32_t count = 0;
+        auto rest = name.substr(instancesPrefix.size());
+        auto [end, err] = std::from_chars(rest.data(), rest.data() + rest.size(), count);
+
+        if (err != std::errc() || end == rest.data() + rest.size() || *end != ':') {
+            return std::nullopt;
+        }
+
+        std::filesystem::path path = rest.substr(end - rest.data() + 1);
+        if (auto geometry = MeshLoader::Load(path)) {
+            return Instances(std::move(*geometry), count, std::move(path));
+        }
+        return std::nullopt;
+    }
+
+    constexpr std::string_view prefix = "spheres:";
+    if (name.starts_with(prefix)) {
+        uint32_t count = 0;
+        auto digits = name.substr(prefix.size());
+        auto [end, err] = std::from_chars(digits.data(), digits.data() + digits.size(), count);
+
+        if (err == std::errc() && end == digits.data() + digits.size()) {
+            return RandomSpheres(count);
+        }
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,32 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <optional>
+#include <string_view>
+
+#include "Scene.h"
+
+/// @brief Canonical scenes shared by the viewer, the headless renderer and the benchmarks.
+namespace Scenes {
+
+/// @brief Two spheres resting on a huge ground sphere, one of them emissive.
+Scene Default();
+
+/// @brief `count` small spheres scattered in front of the camera, above the default ground.
+Scene RandomSpheres(uint32_t count, uint32_t seed = 1);
+
+/// @brief `geometry` scaled to fit and set on the default ground, lit by the sky. `source` is its file, if any.
+Scene WithMesh(MeshGeometry geometry, std::filesystem::path source = {});
+
+/**
+ * @brief `count` copies of `geometry` sharing it, each as large as in @ref `WithMesh`, on a grid on a flat
+ * ground. Every copy is turned at random about the vertical and gets a random material.
+ */
+Scene Instances(MeshGeometry geometry, uint32_t count, std::filesystem::path source = {}, uint32_t seed = 1);
+
+/// @brief Parses `default`, `spheres:<count>`, `mesh:<path>`, `instances:<count>:<path>` or a `.json` path, see @ref `SceneFile::Load`.
+std::optional<Scene> FromName(std::string_view name);
+
+} // namespace Scenes
+
+#endif // SCENES_H
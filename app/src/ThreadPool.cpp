@@ -0,0 +1,147 @@
+#include "ThreadPool.h"
+#include "Walnut/Profiler.h"
+
+#include <algorithm> // max
+#include <string>
+#include <utility> // exchange
+
+namespace {
+
+thread_local uint32_t t_ThreadIdx = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_Queues.resize(threadCount);
+    for (auto& queue : m_Queues) {
+        queue = std::make_unique<Queue>();
+    }
+
+    // Last queue belongs to the thread calling `ParallelFor`.
+    m_Threads.reserve(threadCount - 1);
+    for (uint32_t i = 0; i < threadCount - 1; i++) {
+        m_Threads.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WakeCV.notify_all();
+
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // Published before any index is pushed, the queue mutexes order it for the workers.
+    m_Task = &task;
+    m_Remaining.store(count);
+
+    auto queueCount = (uint32_t)m_Queues.size();
+    for (uint32_t q = 0; q < queueCount; q++) {
+        uint32_t begin = (uint64_t)count * q / queueCount;
+        uint32_t end = (uint64_t)count * (q + 1) / queueCount;
+
+        std::lock_guard lock(m_Queues[q]->Mutex);
+        for (uint32_t idx = begin; idx < end; idx++) {
+            m_Queues[q]->Tasks.push_back(idx);
+        }
+    }
+
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Generation++;
+    }
+    m_WakeCV.notify_all();
+
+    uint32_t callerIdx = queueCount - 1;
+    uint32_t outerIdx = std::exchange(t_ThreadIdx, callerIdx);
+    while (RunOne(callerIdx)) { }
+    t_ThreadIdx = outerIdx;
+
+    std::unique_lock lock(m_Mutex);
+    m_DoneCV.wait(lock, [this] { return m_Remaining.load() == 0; });
+}
+
+uint32_t ThreadPool::GetThreadIndex()
+{
+    return t_ThreadIdx;
+}
+
+void ThreadPool::WorkerLoop(uint32_t workerIdx)
+{
+    Walnut::Profiler::SetThreadName("Worker " + std::to_string(workerIdx));
+    t_ThreadIdx = workerIdx;
+
+    uint64_t seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock(m_Mutex);
+            m_WakeCV.wait(lock, [&] { return m_Stop || m_Generation != seenGeneration; });
+
+            if (m_Stop) {
+                return;
+            }
+            seenGeneration = m_Generation;
+        }
+
+        while (RunOne(workerIdx)) { }
+    }
+}
+
+bool ThreadPool::RunOne(uint32_t workerIdx)
+{
+    uint32_t taskIdx = 0;
+    bool found = false;
+
+    {
+        auto& own = *m_Queues[workerIdx];
+        std::lock_guard lock(own.Mutex);
+        if (!own.Tasks.empty()) {
+            taskIdx = own.Tasks.front();
+            own.Tasks.pop_front();
+            found = true;
+        }
+    }
+
+    // Steal from the far end of a victim's range, it is the work the victim reaches last.
+    auto queueCount = (uint32_t)m_Queues.size();
+    for (uint32_t i = 1; !found && i < queueCount; i++) {
+        auto& victim = *m_Queues[(workerIdx + i) % queueCount];
+        std::lock_guard lock(victim.Mutex);
+        if (!victim.Tasks.empty()) {
+            taskIdx = victim.Tasks.back();
+            victim.Tasks.pop_back();
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    (*m_Task)(taskIdx);
+
+    if (m_Remaining.fetch_sub(1) == 1) {
+        std::lock_guard lock(m_Mutex);
+        m_DoneCV.notify_all();
+    }
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of render workers. Every worker owns a deque of task indices and takes from its
+ * front, idle workers steal from the back of the others. The calling thread works too.
+ */
+class ThreadPool {
+public:
+    /// @param threadCount Total threads including the caller, `0` uses every hardware thread.
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t GetThreadCount() const { return (uint32_t)m_Queues.size(); }
+
+    /**
+     * @brief Index of the calling thread in `[0, GetThreadCount())` while it runs a task, e.g. to
+     * pick per-thread scratch data. The thread calling `ParallelFor` is the last one, `0` outside tasks.
+     */
+    static uint32_t GetThreadIndex();
+
+    /**
+     * @brief Runs `task(idx)` for every index in `[0, count)`, blocks until all of them finished.
+     * Consecutive indices are handed to the same worker, so order tasks for locality.
+     */
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+private:
+    struct Queue {
+        std::mutex Mutex;
+        std::deque<uint32_t> Tasks;
+    };
+
+    void WorkerLoop(uint32_t workerIdx);
+
+    /// @brief Runs one task, from the worker's own queue first, then stolen. False if all are empty.
+    bool RunOne(uint32_t workerIdx);
+
+private:
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Threads;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCV, m_DoneCV;
+    uint64_t m_Generation = 0;
+    bool m_Stop = false;
+
+    const std::function<void(uint32_t)>* m_Task = nullptr;
+    std::atomic<uint32_t> m_Remaining = 0;
+};
+
+#endif // THREAD_POOL_H
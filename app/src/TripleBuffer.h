@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock-free handoff of the latest `T` from one writer thread to one reader thread. The writer
+ * fills the back slot and publishes it, the reader takes the newest published slot. Neither ever
+ * waits for the other, values published in between are skipped.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /// @brief Writer only: the slot to fill next, it keeps whatever it held three publishes ago.
+    T& GetBack() { return m_Slots[m_Back]; }
+
+    /// @brief Writer only: hands the back slot to the reader and takes the middle one as the new back slot.
+    void Publish()
+    {
+        uint8_t middle = m_Middle.exchange(m_Back | Fresh, std::memory_order_acq_rel);
+        m_Back = middle & IndexMask;
+    }
+
+    /// @brief Reader only: takes the latest published slot if there is a new one, see @ref `GetFront`.
+    bool Acquire()
+    {
+        if (!(m_Middle.load(std::memory_order_relaxed) & Fresh)) {
+            return false;
+        }
+
+        uint8_t middle = m_Middle.exchange(m_Front, std::memory_order_acq_rel);
+        m_Front = middle & IndexMask;
+        return true;
+    }
+
+    /// @brief Reader only: the slot taken by the last successful @ref `Acquire`.
+    T& GetFront() { return m_Slots[m_Front]; }
+    const T& GetFront() const { return m_Slots[m_Front]; }
+
+private:
+    /// @brief The middle slot's index, flagged when it was published after the reader's last `Acquire`.
+    static constexpr uint8_t IndexMask = 0x3, Fresh = 0x4;
+
+    std::array<T, 3> m_Slots {};
+    uint8_t m_Back = 0, m_Front = 1;
+    std::atomic<uint8_t> m_Middle { 2 };
+};
+
+#endif // TRIPLE_BUFFER_H
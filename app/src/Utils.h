@@ -0,0 +1,143 @@
+#ifndef UTILS_H
+#define UTILS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm> // min
+#include <array>
+#include <cmath> // pow
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Utils {
+
+///@brief Convert RGBA to ABGR. `color` values must be clamped to `[0,1]`.
+inline uint32_t Vec2Rgba(const glm::vec4& color)
+{
+    auto r = (uint8_t)(color.r * 255.0f);
+    auto g = (uint8_t)(color.g * 255.0f);
+    auto b = (uint8_t)(color.b * 255.0f);
+    auto a = (uint8_t)(color.a * 255.0f);
+
+    // aa | bb | gg | rr -> 8 bytes
+    return (a << 24) | (b << 16) | (g << 8) | r;
+}
+
+/// @brief How @ref `ResolveRow` maps accumulated radiance to display values.
+struct ResolveParams {
+    /// @brief `1 / samples`, times the exposure.
+    float Scale = 1.0f;
+    /// @brief Narkowicz's fit of the ACES filmic curve instead of a hard clamp.
+    bool Aces = false;
+    /// @brief Encode with the sRGB transfer curve instead of storing linear values.
+    bool Srgb = false;
+};
+
+constexpr uint32_t SrgbLutSize = 4096;
+
+/// @brief sRGB encoded 8-bit value of `i / (SrgbLutSize - 1)`, built once.
+inline const uint8_t* SrgbLut()
+{
+    static const auto lut = [] {
+        std::array<uint8_t, SrgbLutSize> table {};
+        for (uint32_t i = 0; i < SrgbLutSize; i++) {
+            float linear = (float)i / (float)(SrgbLutSize - 1);
+            float encoded = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            table[i] = (uint8_t)(encoded * 255.0f + 0.5f);
+        }
+        return table;
+    }();
+
+    return lut.data();
+}
+
+inline glm::vec3 Aces(const glm::vec3& x)
+{
+    return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+}
+
+/**
+ * @brief Converts `count` accumulated colors to RGBA8 pixels with an opaque alpha: scaled, tonemapped
+ * and clamped to `[0,1]`, then sRGB encoded or truncated like @ref `Vec2Rgba`. Four pixels per
+ * iteration with SSE2, the sRGB curve is a table lookup.
+ */
+inline void ResolveRow(const glm::vec3* accum, uint32_t count, const ResolveParams& params, uint32_t* out)
+{
+    const uint8_t* lut = params.Srgb ? SrgbLut() : nullptr;
+    uint32_t i = 0;
+
+#ifdef RT_SSE2
+    const float* src = &accum[0].x;
+    const __m128 scale = _mm_set1_ps(params.Scale), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 max = _mm_set1_ps(255.0f), lutMax = _mm_set1_ps((float)(SrgbLutSize - 1)), half = _mm_set1_ps(0.5f);
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 alpha = _mm_set_ps(255.0f, 0.0f, 0.0f, 0.0f);
+
+    auto map = [&](__m128 rgb) {
+        rgb = _mm_mul_ps(rgb, scale);
+        if (params.Aces) {
+            __m128 num = _mm_mul_ps(rgb, _mm_add_ps(_mm_mul_ps(rgb, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+            __m128 den = _mm_add_ps(_mm_mul_ps(rgb, _mm_add_ps(_mm_mul_ps(rgb, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+            rgb = _mm_div_ps(num, den);
+        }
+        return _mm_min_ps(_mm_max_ps(rgb, zero), one);
+    };
+
+    auto toInt = [&](__m128 rgb) {
+        return _mm_cvttps_epi32(_mm_or_ps(_mm_and_ps(_mm_mul_ps(rgb, max), rgbMask), alpha));
+    };
+
+    for (; i + 4 <= count; i += 4, src += 12) {
+        // r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3, regrouped to one pixel per register.
+        __m128 a = _mm_loadu_ps(src), b = _mm_loadu_ps(src + 4), c = _mm_loadu_ps(src + 8);
+
+        __m128 p0 = map(a);
+        __m128 p1 = map(_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 3, 3)), b, _MM_SHUFFLE(1, 1, 2, 0)));
+        __m128 p2 = map(_mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 3, 2)));
+        __m128 p3 = map(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 2, 1)));
+
+        if (lut) {
+            alignas(16) int32_t idx[16];
+            _mm_store_si128((__m128i*)idx, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p0, lutMax), half)));
+            _mm_store_si128((__m128i*)idx + 1, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p1, lutMax), half)));
+            _mm_store_si128((__m128i*)idx + 2, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p2, lutMax), half)));
+            _mm_store_si128((__m128i*)idx + 3, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p3, lutMax), half)));
+
+            for (uint32_t k = 0; k < 4; k++) {
+                const int32_t* rgb = idx + k * 4;
+                out[i + k] = 0xff000000u | (lut[rgb[2]] << 16) | (lut[rgb[1]] << 8) | lut[rgb[0]];
+            }
+            continue;
+        }
+
+        // Saturating packs, 32 to 16 to 8 bits, leave the bytes in r g b a order.
+        __m128i lo = _mm_packs_epi32(toInt(p0), toInt(p1));
+        __m128i hi = _mm_packs_epi32(toInt(p2), toInt(p3));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; i++) {
+        glm::vec3 color = accum[i] * params.Scale;
+        color = params.Aces ? Aces(color) : color;
+        // Not `glm::clamp`, it keeps NaN, which would index past the LUT. NaN becomes 0 as in the SSE path.
+        for (int c = 0; c < 3; c++) {
+            color[c] = color[c] > 0.0f ? std::min(color[c], 1.0f) : 0.0f;
+        }
+
+        if (lut) {
+            glm::uvec3 idx(color * (float)(SrgbLutSize - 1) + 0.5f);
+            out[i] = 0xff000000u | (lut[idx.b] << 16) | (lut[idx.g] << 8) | lut[idx.r];
+        } else {
+            out[i] = Vec2Rgba(glm::vec4(color, 1.0f));
+        }
+    }
+}
+
+} // namespace Utils
+
+#endif // UTILS_H
@@ -0,0 +1,26 @@
+#include "WalnutImageSink.h"
+
+void WalnutImageSink::OnResize(uint32_t width, uint32_t height)
+{
+    if (m_Image) {
+        m_Image->Resize(width, height);
+    } else {
+        m_Image = std::make_shared<Walnut::Image>(width, height,
+            Walnut::ImageFormat::RGBA);
+    }
+}
+
+void WalnutImageSink::SetData(const uint32_t* pixels)
+{
+    m_Image->SetData(pixels);
+}
+
+uint32_t* WalnutImageSink::BeginFrame()
+{
+    return (uint32_t*)m_Image->BeginUpload();
+}
+
+void WalnutImageSink::EndFrame()
+{
+    m_Image->EndUpload();
+}
@@ -0,0 +1,26 @@
+#ifndef WALNUT_IMAGE_SINK_H
+#define WALNUT_IMAGE_SINK_H
+
+#include "Walnut/Image.h"
+
+#include <memory>
+
+#include "ImageSink.h"
+
+/// @brief Uploads every frame to a `Walnut::Image`, for the viewport.
+class WalnutImageSink : public ImageSink {
+public:
+    void OnResize(uint32_t width, uint32_t height) override;
+    void SetData(const uint32_t* pixels) override;
+
+    /// @brief Hands out the image's persistently mapped staging buffer.
+    uint32_t* BeginFrame() override;
+    void EndFrame() override;
+
+    auto GetImage() const { return m_Image; }
+
+private:
+    std::shared_ptr<Walnut::Image> m_Image;
+};
+
+#endif // WALNUT_IMAGE_SINK_H
@@ -0,0 +1,295 @@
+// Headless batch renderer. Renders a scene to a file without a window or a GPU.
+
+#include "Walnut/Profiler.h"
+#include "Walnut/Timer.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h> // join
+
+#include <charconv>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "Camera.h"
+#include "ImageIO.h"
+#include "ImageWriter.h"
+#include "Renderer.h"
+#include "SceneCache.h"
+#include "Scenes.h"
+
+namespace {
+
+struct Options {
+    std::string SceneName = "default";
+    /// @brief `--scene` was given, an existing cache would silently replace it.
+    bool SceneGiven = false;
+    std::string OutPath = "render.png";
+    /// @brief Scene cache, read instead of `SceneName` when it exists, written otherwise.
+    std::string CachePath;
+    /// @brief Chrome trace of the render, written when set.
+    std::string TracePath;
+    uint32_t Width = 1280, Height = 720;
+    uint32_t Samples = 64;
+    /// @brief Writes `OutPath` every that many samples while rendering, `0` only at the end.
+    uint32_t Autosave = 0;
+    uint32_t Threads = 0;
+    /// @brief Adaptive sampling threshold, `0` samples every pixel `Samples` times.
+    float Noise = 0.0f;
+    uint32_t Bounces = 8;
+    bool Roulette = true;
+    bool Wavefront = false;
+    bool Sky = true;
+    /// @brief Display transform of 8-bit outputs, `.exr` and `.hdr` only get the exposure.
+    float Exposure = 0.0f;
+    Renderer::Tonemapper Tonemap = Renderer::Tonemapper::Clamp;
+    bool SRGB = false;
+};
+
+void PrintUsage()
+{
+    fmt::println(stderr,
+        "Usage: cherno-raytracer-cli [options]\n"
+        "  --scene <name>      default | spheres:<count> | mesh:<file.obj|file.ply> |\n"
+        "                      instances:<count>:<file.obj|file.ply> | <file.json>\n"
+        "  --width <px>        image width                 (default: 1280)\n"
+        "  --height <px>       image height                (default: 720)\n"
+        "  --samples <n>       accumulated frames          (default: 64)\n"
+        "  --noise <t>         adaptive sampling, stop tiles below relative noise t,\n"
+        "                      --samples is then the maximum\n"
+        "  --threads <n>       render threads, 0 = all     (default: 0)\n"
+        "  --bounces <n>       maximum path length         (default: 8)\n"
+        "  --no-roulette       disable Russian roulette\n"
+        "  --wavefront         trace all pixels bounce by bounce\n"
+        "  --cache <file>      load the scene and its BVHs from this cache if it exists,\n"
+        "                      without --scene, otherwise build them and write it\n"
+        "  --no-sky            black background\n"
+        "  --exposure <stops>  scale radiance by 2^stops   (default: 0)\n"
+        "  --tonemap <op>      clamp | aces                (default: clamp)\n"
+        "  --srgb              sRGB encode 8-bit outputs\n"
+        "  --autosave <n>      also write --out every n samples, in the background\n"
+        "  --trace <file>      profile the render, write a Chrome trace (chrome://tracing, Perfetto)\n"
+        "  --out <file>        .png, .bmp, .tga, .jpg, or linear .exr or .hdr\n"
+        "                                                  (default: render.png)");
+}
+
+bool ParseUInt(std::string_view str, uint32_t& value)
+{
+    auto [end, err] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return err == std::errc() && end == str.data() + str.size();
+}
+
+bool ParseFloat(std::string_view str, float& value)
+{
+    auto [end, err] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return err == std::errc() && end == str.data() + str.size();
+}
+
+bool ParseArgs(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--no-sky") {
+            options.Sky = false;
+            continue;
+        }
+        if (arg == "--no-roulette") {
+            options.Roulette = false;
+            continue;
+        }
+        if (arg == "--wavefront") {
+            options.Wavefront = true;
+            continue;
+        }
+        if (arg == "--srgb") {
+            options.SRGB = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fmt::println(stderr, "Error: unknown or incomplete option '{}'", arg);
+            return false;
+        }
+        std::string_view value = argv[++i];
+
+        bool ok = true;
+        if (arg == "--scene") {
+            options.SceneName = value;
+            options.SceneGiven = true;
+        } else if (arg == "--cache") {
+            options.CachePath = value;
+        } else if (arg == "--trace") {
+            options.TracePath = value;
+        } else if (arg == "--out") {
+            options.OutPath = value;
+        } else if (arg == "--width") {
+            ok = ParseUInt(value, options.Width) && options.Width > 0;
+        } else if (arg == "--height") {
+            ok = ParseUInt(value, options.Height) && options.Height > 0;
+        } else if (arg == "--samples") {
+            ok = ParseUInt(value, options.Samples) && options.Samples > 0;
+        } else if (arg == "--bounces") {
+            ok = ParseUInt(value, options.Bounces) && options.Bounces > 0;
+        } else if (arg == "--noise") {
+            ok = ParseFloat(value, options.Noise) && options.Noise > 0.0f;
+        } else if (arg == "--autosave") {
+            ok = ParseUInt(value, options.Autosave);
+        } else if (arg == "--threads") {
+            ok = ParseUInt(value, options.Threads);
+        } else if (arg == "--exposure") {
+            ok = ParseFloat(value, options.Exposure);
+        } else if (arg == "--tonemap") {
+            if (value == "clamp") {
+                options.Tonemap = Renderer::Tonemapper::Clamp;
+            } else if (value == "aces") {
+                options.Tonemap = Renderer::Tonemapper::ACES;
+            } else {
+                ok = false;
+            }
+        } else {
+            fmt::println(stderr, "Error: unknown option '{}'", arg);
+            return false;
+        }
+
+        if (!ok) {
+            fmt::println(stderr, "Error: invalid value '{}' for {}", value, arg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    // Checked up front, the image is only written after the render.
+    if (!ImageIO::IsSupportedPath(options.OutPath)) {
+        fmt::println(stderr, "Error: unsupported image format '{}'", options.OutPath);
+        return 1;
+    }
+
+    Walnut::Timer loadTimer;
+
+    Renderer renderer;
+
+    bool useCache = !options.CachePath.empty() && std::filesystem::exists(options.CachePath);
+    if (useCache && options.SceneGiven) {
+        fmt::println(stderr, "Error: the scene cache '{}' exists and holds the scene, drop --scene or delete the cache",
+            options.CachePath);
+        return 1;
+    }
+
+    if (useCache) {
+        auto cached = SceneCache::Load(options.CachePath);
+        if (!cached) {
+            return 1;
+        }
+
+        renderer.SetScene(std::make_shared<const Scene>(std::move(cached->Contents)));
+        renderer.SetAccel(std::move(cached->SphereBVH), std::move(cached->GeometryBVHs));
+    } else if (auto loaded = Scenes::FromName(options.SceneName)) {
+        renderer.SetScene(std::make_shared<const Scene>(std::move(*loaded)));
+    }
+
+    if (!renderer.GetScene()) {
+        fmt::println(stderr, "Error: unknown scene '{}'", options.SceneName);
+        PrintUsage();
+        return 1;
+    }
+    const Scene& scene = *renderer.GetScene();
+
+    fmt::println("Loaded '{}' in {:.1f}ms", useCache ? options.CachePath : options.SceneName, loadTimer.ElapsedMillis());
+
+    Camera camera(45.0f, 0.1f, 100.0f);
+    camera.OnResize(options.Width, options.Height);
+
+    renderer.Sky = options.Sky;
+    renderer.GetSettings().ThreadCount = options.Threads;
+    renderer.GetSettings().MaxBounces = options.Bounces;
+    renderer.GetSettings().RussianRoulette = options.Roulette;
+    renderer.GetSettings().Wavefront = options.Wavefront;
+    renderer.GetSettings().Adaptive = options.Noise > 0.0f;
+    renderer.GetSettings().NoiseThreshold = options.Noise;
+    renderer.GetSettings().Exposure = options.Exposure;
+    renderer.GetSettings().Tonemap = options.Tonemap;
+    renderer.GetSettings().SRGB = options.SRGB;
+    renderer.OnResize(options.Width, options.Height);
+
+    size_t triangleCount = 0;
+    for (auto& mesh : scene.Meshes) {
+        triangleCount += mesh.GetTriangleCount();
+    }
+
+    fmt::println("Rendering '{}' ({} spheres, {} triangles) at {}x{}, {} samples",
+        useCache ? options.CachePath : options.SceneName, scene.Spheres.size(), triangleCount, options.Width, options.Height, options.Samples);
+
+    ImageWriter writer;
+
+    if (!options.TracePath.empty()) {
+        Walnut::Profiler::SetThreadName("Main");
+        Walnut::Profiler::SetEnabled(true);
+    }
+
+    Walnut::Timer timer;
+
+    RenderStats stats;
+    float statsSeconds = 0.0f;
+
+    uint32_t samples = 0;
+    while (samples < options.Samples) {
+        Walnut::Profiler::BeginFrame();
+        renderer.Render(camera);
+        samples++;
+
+        stats += renderer.GetStats();
+        statsSeconds += renderer.GetStats().FrameSeconds;
+
+        // Skipped while the last one is still encoding, rendering never waits for it.
+        if (options.Autosave && samples % options.Autosave == 0 && samples < options.Samples && writer.GetPendingCount() == 0) {
+            writer.Submit(options.OutPath, renderer);
+        }
+
+        if (renderer.GetConvergedTileCount() == renderer.GetTileCount()) {
+            break;
+        }
+    }
+
+    float elapsedMs = timer.ElapsedMillis();
+    fmt::println("Done in {:.1f}ms, {} samples, {:.3f}ms per sample", elapsedMs, samples, elapsedMs / samples);
+    if (RenderStats::Enabled) {
+        stats.FrameSeconds = statsSeconds;
+        fmt::println("Rays: {} primary, {} secondary, {:.2f}M rays/s, {} sphere and {} triangle tests",
+            stats.PrimaryRays, stats.SecondaryRays, stats.GetRaysPerSecond() * 1e-6, stats.SphereTests, stats.TriangleTests);
+        fmt::println("Path lengths: {}", fmt::join(stats.PathLengths, " "));
+    }
+    if (options.Noise > 0.0f) {
+        fmt::println("Converged tiles: {} / {}", renderer.GetConvergedTileCount(), renderer.GetTileCount());
+    }
+
+    // The first frame built the BVHs.
+    if (!options.CachePath.empty() && !useCache && SceneCache::Save(options.CachePath, scene, renderer.GetSphereBVH(), renderer.GetGeometryBVHs())) {
+        fmt::println("Wrote scene cache {}", options.CachePath);
+    }
+
+    // Holds the latest events of every thread, the first samples may be gone on long renders.
+    if (!options.TracePath.empty() && Walnut::Profiler::ExportChromeTrace(options.TracePath)) {
+        fmt::println("Wrote trace {}", options.TracePath);
+    }
+
+    if (!writer.Submit(options.OutPath, renderer) || !writer.Flush()) {
+        return 1;
+    }
+
+    fmt::println("Wrote {}", options.OutPath);
+    return 0;
+}
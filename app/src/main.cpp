@@ -2,65 +2,59 @@
 #include "Walnut/EntryPoint.h"
 
 #include "Walnut/Image.h"
-#include "Walnut/Timer.h"
+#include "Walnut/ProfilerPanel.h"
 
 #include <fmt/format.h>
 
+#include <array>
+#include <utility> // exchange
+
 #include <glm/gtc/type_ptr.hpp>
 #include <nfd.h>
 
 #include "Camera.h"
-#include "Color.h"
+#include "ImageWriter.h"
+#include "Intersect.h"
+#include "MeshLoader.h"
+#include "RenderThread.h"
 #include "Renderer.h"
+#include "SceneFile.h"
+#include "Scenes.h"
+#include "WalnutImageSink.h"
 
 class ExampleLayer : public Walnut::Layer {
 public:
-    ExampleLayer()
+    /// @brief `scenePath` is watched and `scene` reloaded from it on changes, empty for none.
+    ExampleLayer(Scene scene, std::filesystem::path scenePath)
         : m_Camera(45.0f, 0.1f, 100.0f)
+        , m_Scene(std::move(scene))
+        , m_SceneWatcher(std::move(scenePath))
     {
-        // materials
-        {
-            m_Scene.Materials.emplace_back(Material {
-                .Albedo = Color::Magenta,
-                .Roughness = 0.0f,
-            });
-
-            m_Scene.Materials.emplace_back(Material {
-                .Albedo = Color::Sky_950,
-                .Roughness = 0.1f,
-            });
-
-            m_Scene.Materials.emplace_back(Material {
-                .Albedo = Color::Orange_600,
-                .Roughness = 0.1f,
-                .EmissionColor = Color::Orange_600,
-                .EmissionPower = 2.0f });
-        }
-
-        m_Scene.Spheres.emplace_back(Sphere {
-            .Pos = { 0.0f, 0.0f, -3.0f },
-            .Radius = 1.0f,
-            .MatIdx = 0,
-        });
-
-        m_Scene.Spheres.emplace_back(Sphere {
-            .Pos = { 2.0f, 0.0f, -3.0f },
-            .Radius = 1.0f,
-            .MatIdx = 2,
-        });
-
-        m_Scene.Spheres.emplace_back(Sphere {
-            .Pos = { 0.0f, -101.0f, -3.0f },
-            .Radius = 100.0f,
-            .MatIdx = 1,
-        });
+        m_Input.Settings.Preview = true;
+        // How often the render thread shows its progress, about every UI frame at 60 Hz.
+        m_Input.Settings.FrameBudgetMs = 12.0f;
     }
 
     virtual void OnUpdate(float ts) override
     {
         if (m_Camera.OnUpdate(ts)) {
-            m_Renderer.ResetFrameIdx();
+            m_Input.Resets++;
+        }
+
+        if (m_SceneWatcher.Poll()) {
+            ReloadScene();
+        }
+    }
+
+    /// @brief Applies the edits of the watched file, invalidating only what they touched.
+    void ReloadScene()
+    {
+        auto changes = SceneFile::Reload(m_SceneWatcher.GetPath(), m_Scene);
+        if (!changes) {
+            return;
         }
+
+        m_SceneEdited |= changes->Any();
     }
 
     virtual void OnUIRender() override
@@ -72,41 +66,178 @@ public:
                 m_Pause = !m_Pause;
             }
             ImGui::SameLine();
-            ImGui::Text("Last render: %.3fms", m_LastRenderTime);
+            ImGui::Text("Last render: %.3fms", m_RenderThread.GetFrame().RenderMs);
+            ImGui::Text("Intersection kernel: %s", Intersect::GetSpheresKernel().Name);
 
             if (ImGui::Button("Reset")) {
-                m_Renderer.ResetFrameIdx();
+                m_Input.Resets++;
+            }
+            ImGui::SameLine();
+            ImGui::Checkbox("Accumulate", &m_Input.Settings.Accum);
+
+            {
+                const auto& frame = m_RenderThread.GetFrame();
+                auto& settings = m_Input.Settings;
+                const uint32_t maxThreads = 256, minTile = 1, maxTile = 256;
+
+                ImGui::DragScalar("Threads (0 = all)", ImGuiDataType_U32, &settings.ThreadCount, 0.1f, nullptr, &maxThreads);
+                ImGui::DragScalar("Tile size", ImGuiDataType_U32, &settings.TileSize, 0.1f, &minTile, &maxTile);
+                ImGui::DragFloat("Frame budget (0 = whole frames)", &settings.FrameBudgetMs, 0.1f, 0.0f, 1000.0f, "%.1fms");
+                ImGui::Checkbox("Cache ray directions", &settings.CacheRayDirections);
+
+                const uint32_t minBounces = 1, maxBounces = 64;
+                bool pathsChanged = ImGui::DragScalar("Max bounces", ImGuiDataType_U32, &settings.MaxBounces, 0.1f, &minBounces, &maxBounces);
+                pathsChanged |= ImGui::Checkbox("Russian roulette", &settings.RussianRoulette);
+                if (settings.RussianRoulette) {
+                    pathsChanged |= ImGui::DragScalar("Roulette after", ImGuiDataType_U32, &settings.RouletteMinBounces, 0.1f, &minBounces, &maxBounces);
+                }
+                if (pathsChanged) {
+                    m_Input.Resets++;
+                }
+
+                ImGui::Checkbox("Wavefront", &settings.Wavefront);
+                if (settings.Wavefront) {
+                    ImGui::SameLine();
+                    ImGui::Checkbox("Sort rays", &settings.SortRays);
+                }
+
+                ImGui::Checkbox("Preview while moving", &settings.Preview);
+                if (settings.Preview) {
+                    const uint32_t minScale = 1, maxScale = 64;
+
+                    ImGui::SameLine();
+                    ImGui::Text("1/%u", frame.PreviewScale);
+                    ImGui::DragFloat("Preview budget", &settings.PreviewBudgetMs, 0.1f, 1.0f, 1000.0f, "%.1fms");
+                    ImGui::DragScalar("Max preview block", ImGuiDataType_U32, &settings.PreviewMaxScale, 0.1f, &minScale, &maxScale);
+                }
+
+                ImGui::Checkbox("Adaptive sampling", &settings.Adaptive);
+                if (settings.Adaptive) {
+                    const uint32_t minSamples = 1;
+
+                    ImGui::DragFloat("Noise threshold", &settings.NoiseThreshold, 0.001f, 0.001f, 1.0f, "%.3f");
+                    ImGui::DragScalar("Min samples", ImGuiDataType_U32, &settings.AdaptiveMinSamples, 0.1f, &minSamples, nullptr);
+                    ImGui::Text("Converged tiles: %u / %u", frame.ConvergedTiles, frame.TileCount);
+                }
+
+                // Applied when resolving, the accumulated radiance is kept.
+                const char* tonemappers[] = { "Clamp", "ACES" };
+                int tonemap = (int)settings.Tonemap;
+                ImGui::DragFloat("Exposure", &settings.Exposure, 0.05f, -10.0f, 10.0f, "%.2f stops");
+                if (ImGui::Combo("Tonemap", &tonemap, tonemappers, IM_ARRAYSIZE(tonemappers))) {
+                    settings.Tonemap = (Renderer::Tonemapper)tonemap;
+                }
+                ImGui::Checkbox("sRGB", &settings.SRGB);
+            }
+
+            if (ImGui::Button("Load mesh")) {
+                nfdchar_t* inPath = nullptr;
+                nfdresult_t result = NFD_OpenDialog("obj,ply", nullptr, &inPath);
+
+                if (result == NFD_OKAY) {
+                    if (auto geometry = MeshLoader::Load(inPath)) {
+                        m_Scene = Scenes::WithMesh(std::move(*geometry), inPath);
+                        m_SceneWatcher = {};
+                        m_SceneEdited = true;
+                    }
+                    free(inPath);
+                } else if (result == NFD_ERROR) {
+                    fmt::println(stderr, "Error: {}", NFD_GetError());
+                }
+            }
+            ImGui::SameLine();
+
+            if (ImGui::Button("Open scene")) {
+                nfdchar_t* inPath = nullptr;
+                nfdresult_t result = NFD_OpenDialog("json", nullptr, &inPath);
+
+                if (result == NFD_OKAY) {
+                    if (auto scene = SceneFile::Load(inPath)) {
+                        m_Scene = std::move(*scene);
+                        m_SceneWatcher = SceneFile::Watcher(inPath);
+                        m_SceneEdited = true;
+                    }
+                    free(inPath);
+                } else if (result == NFD_ERROR) {
+                    fmt::println(stderr, "Error: {}", NFD_GetError());
+                }
+            }
+            ImGui::SameLine();
+
+            if (ImGui::Button("Save scene")) {
+                nfdchar_t* outPath = nullptr;
+                nfdresult_t result = NFD_SaveDialog("json", nullptr, &outPath);
+
+                if (result == NFD_OKAY) {
+                    // Watch the saved file, its edits are reloaded from now on.
+                    if (SceneFile::Save(outPath, m_Scene)) {
+                        m_SceneWatcher = SceneFile::Watcher(outPath);
+                    }
+                    free(outPath);
+                } else if (result == NFD_ERROR) {
+                    fmt::println(stderr, "Error: {}", NFD_GetError());
+                }
             }
             ImGui::SameLine();
-            ImGui::Checkbox("Accumulate", &m_Renderer.GetSettings().Accum);
 
             if (ImGui::Button("Save")) {
                 nfdchar_t* outPath = nullptr;
-                nfdresult_t result = NFD_SaveDialog(nullptr, nullptr, &outPath);
+                nfdresult_t result = NFD_SaveDialog("png,jpg,bmp,tga,exr,hdr", nullptr, &outPath);
 
                 if (result == NFD_OKAY) {
-                    m_Renderer.GetFinalImage()->SaveToBmp(outPath);
+                    // Snapshots the accumulation between two renders, the UI does not wait for it.
+                    m_RenderThread.Post([this, path = std::filesystem::path(outPath)](Renderer& renderer) {
+                        m_ImageWriter.Submit(path, renderer);
+                    });
                     free(outPath);
                 } else if (result == NFD_ERROR) {
                     fmt::println(stderr, "Error: {}", NFD_GetError());
                 }
             }
 
+            {
+                const uint32_t maxInterval = 1 << 16;
+                ImGui::DragScalar("Autosave every (0 = off)", ImGuiDataType_U32, &m_AutosaveInterval, 1.0f, nullptr, &maxInterval, "%u samples");
+                if (m_AutosaveInterval) {
+                    ImGui::InputText("Autosave path", m_AutosavePath, sizeof(m_AutosavePath));
+                }
+                if (uint32_t pending = m_ImageWriter.GetPendingCount()) {
+                    ImGui::Text("Writing %u image(s)", pending);
+                }
+            }
+
+            if (!m_SceneWatcher.GetPath().empty()) {
+                ImGui::Text("Watching %s", m_SceneWatcher.GetPath().filename().string().c_str());
+            }
+
             ImGui::End();
         }
         {
             ImGui::Begin("Scene");
 
-            ImGui::Checkbox("Sky", &m_Renderer.Sky);
+            ImGui::Checkbox("Sky", &m_Input.Sky);
             ImGui::Separator();
 
+            for (int i = 0; auto& mesh : m_Scene.Meshes) {
+                ImGui::PushID(i + (int)m_Scene.Spheres.size());
+                ImGui::Text("Mesh %d: %u triangles", i, mesh.GetTriangleCount());
+                m_SceneEdited |= ImGui::DragInt("Material", &mesh.MatIdx, 1.0f, 0, (int)m_Scene.Materials.size() - 1);
+                // Moves the instance only, its geometry keeps its BVH. Clamped even when typed, a zero scale
+                // has no inverse transform.
+                m_SceneEdited |= ImGui::DragFloat("Scale", &mesh.Scale, 0.01f, 0.001f, 1000.0f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+                m_SceneEdited |= ImGui::DragFloat3("Rotation", glm::value_ptr(mesh.Rotation), 1.0f);
+                m_SceneEdited |= ImGui::DragFloat3("Offset", glm::value_ptr(mesh.Offset), 0.1f);
+                ImGui::PopID();
+                i++;
+            }
+
             if (ImGui::CollapsingHeader("Objects")) {
                 for (int i = 0; auto& sphere : m_Scene.Spheres) {
                     ImGui::PushID(i);
 
-                    ImGui::DragFloat3("Position", glm::value_ptr(sphere.Pos), 0.1f);
-                    ImGui::DragFloat("Radius", &sphere.Radius, 0.1f);
-                    ImGui::DragInt("Material", &sphere.MatIdx,
+                    m_SceneEdited |= ImGui::DragFloat3("Position", glm::value_ptr(sphere.Pos), 0.1f);
+                    m_SceneEdited |= ImGui::DragFloat("Radius", &sphere.Radius, 0.1f, 0.001f, FLT_MAX, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+                    m_SceneEdited |= ImGui::DragInt("Material", &sphere.MatIdx,
                         1.0f, 0, (int)m_Scene.Materials.size() - 1);
 
                     ImGui::Separator();
@@ -121,12 +252,12 @@ public:
                 auto materialLabel = fmt::format("Material {}", i);
 
                 if (ImGui::CollapsingHeader(materialLabel.c_str())) {
-                    ImGui::ColorEdit3("Albedo", glm::value_ptr(material.Albedo));
-                    ImGui::DragFloat("Roughness", &material.Roughness, 0.01f, 0.0f, 1.0f);
-                    ImGui::DragFloat("Metallic", &material.Metallic, 0.01f, 0.0f, 1.0f);
+                    m_SceneEdited |= ImGui::ColorEdit3("Albedo", glm::value_ptr(material.Albedo));
+                    m_SceneEdited |= ImGui::DragFloat("Roughness", &material.Roughness, 0.01f, 0.0f, 1.0f);
+                    m_SceneEdited |= ImGui::DragFloat("Metallic", &material.Metallic, 0.01f, 0.0f, 1.0f);
 
-                    ImGui::ColorEdit3("EmissionColor", glm::value_ptr(material.EmissionColor));
-                    ImGui::DragFloat("EmissionPower", &material.EmissionPower, 0.1f, 0.0f, FLT_MAX);
+                    m_SceneEdited |= ImGui::ColorEdit3("EmissionColor", glm::value_ptr(material.EmissionColor));
+                    m_SceneEdited |= ImGui::DragFloat("EmissionPower", &material.EmissionPower, 0.1f, 0.0f, FLT_MAX);
 
                     ImGui::Spacing();
                 }
@@ -143,7 +274,7 @@ public:
             m_ViewportWidth = (uint32_t)ImGui::GetContentRegionAvail().x;
             m_ViewportHeight = (uint32_t)ImGui::GetContentRegionAvail().y;
 
-            auto image = m_Renderer.GetFinalImage();
+            auto image = m_ImageSink->GetImage();
             if (image) {
                 ImGui::Image(image->GetDescriptorSet(),
                     { (float)image->GetWidth(), (float)image->GetHeight() },
@@ -154,29 +285,104 @@ public:
             ImGui::PopStyleVar();
         }
 
-        if (!m_Pause) {
-            Render();
+        RenderStatsPanel();
+        m_ProfilerPanel.OnUIRender();
+
+        Render();
+    }
+
+    void RenderStatsPanel()
+    {
+        ImGui::Begin("Stats");
+
+        if (!RenderStats::Enabled) {
+            ImGui::TextUnformatted("Compiled out, build with RT_STATS in a non-Release configuration.");
+            ImGui::End();
+            return;
+        }
+
+        const auto& stats = m_RenderThread.GetFrame().Stats;
+        auto row = [](const char* label, auto value) {
+            ImGui::TextUnformatted(fmt::format("{:<16}{}", label, value).c_str());
+        };
+
+        ImGui::Text("Rays/s: %.2fM", stats.GetRaysPerSecond() * 1e-6);
+        row("Primary rays", stats.PrimaryRays);
+        row("Secondary rays", stats.SecondaryRays);
+        row("Sphere tests", stats.SphereTests);
+        row("Triangle tests", stats.TriangleTests);
+        row("Hits", stats.Hits);
+        row("Samples", stats.Samples);
+        ImGui::Text("Samples/pixel: %.1f", stats.SamplesPerPixel);
+
+        std::array<float, RenderStats::PathLengthBins> pathLengths;
+        for (uint32_t i = 0; i < RenderStats::PathLengthBins; i++) {
+            pathLengths[i] = (float)stats.PathLengths[i];
         }
+        ImGui::PlotHistogram("Path lengths", pathLengths.data(), (int)pathLengths.size(),
+            0, "bounces, last bin and longer", 0.0f, FLT_MAX, { 0.0f, 80.0f });
+
+        ImGui::End();
     }
 
+    /// @brief Shows the render thread's latest frame, if there is a new one, and hands it this frame's input.
     void Render()
     {
-        Walnut::Timer timer;
+        if (m_RenderThread.AcquireFrame()) {
+            const auto& frame = m_RenderThread.GetFrame();
+            // The one copy per shown frame, about 1ms at 1080p. The staging buffers stay on this thread,
+            // the GPU reads them frames later and a resize releases them.
+            m_ImageSink->OnResize(frame.Width, frame.Height);
+            m_ImageSink->SetData(frame.Pixels.data());
+
+            // A frame may add several samples or none, save once per interval.
+            // Skipped while the last one is still encoding, neither thread waits for it.
+            uint32_t samples = frame.FrameIdx - 1;
+            if (samples < m_AutosavedSamples) {
+                m_AutosavedSamples = 0;
+            }
+            if (m_AutosaveInterval && samples >= m_AutosavedSamples + m_AutosaveInterval && m_ImageWriter.GetPendingCount() == 0) {
+                m_RenderThread.Post([this, path = std::filesystem::path(m_AutosavePath)](Renderer& renderer) {
+                    m_ImageWriter.Submit(path, renderer);
+                });
+                m_AutosavedSamples = samples;
+            }
+        }
 
-        m_Renderer.OnResize(m_ViewportWidth, m_ViewportHeight);
-        m_Camera.OnResize(m_ViewportWidth, m_ViewportHeight);
-        m_Renderer.Render(m_Scene, m_Camera);
+        if (std::exchange(m_SceneEdited, false)) {
+            m_Input.SceneSnapshot = std::make_shared<const Scene>(m_Scene);
+        }
 
-        m_LastRenderTime = timer.ElapsedMillis();
+        m_Camera.OnResize(m_ViewportWidth, m_ViewportHeight);
+        m_Input.View = m_Camera;
+        m_Input.Width = m_ViewportWidth;
+        m_Input.Height = m_ViewportHeight;
+        m_Input.Paused = m_Pause;
+        m_RenderThread.Submit(m_Input);
     }
 
 private:
-    Renderer m_Renderer;
+    std::shared_ptr<WalnutImageSink> m_ImageSink = std::make_shared<WalnutImageSink>();
     Camera m_Camera;
+    /// @brief Edited by the UI only. After edits the render thread gets a snapshot, sharing the mesh
+    /// geometry, and the renderer finds out itself what changed.
     Scene m_Scene;
+    bool m_SceneEdited = true;
+    SceneFile::Watcher m_SceneWatcher;
     uint32_t m_ViewportWidth, m_ViewportHeight;
 
-    float m_LastRenderTime = 0;
+    Walnut::ProfilerPanel m_ProfilerPanel;
+
+    ImageWriter m_ImageWriter;
+    uint32_t m_AutosaveInterval = 0;
+    uint32_t m_AutosavedSamples = 0;
+    char m_AutosavePath[256] = "autosave.png";
+
+    /// @brief The settings, camera and scene submitted every UI frame, the renderer's own live on its thread.
+    RenderThread::Input m_Input;
+    /// @brief Declared after `m_ImageWriter`, its queued saves are handed to the writer when it stops.
+    RenderThread m_RenderThread;
+
     bool m_Pause = false;
 };
 
@@ -185,8 +391,20 @@ Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
     Walnut::ApplicationSpecification spec;
     spec.Name = "Walnut Example";
 
+    // Optional scene, see `Scenes::FromName`. Scene files are watched for edits.
+    std::string_view sceneName = argc > 1 ? argv[1] : "default";
+    auto scene = Scenes::FromName(sceneName);
+
+    std::filesystem::path scenePath;
+    if (!scene) {
+        fmt::println(stderr, "Error: unknown scene '{}', using the default one", sceneName);
+        scene = Scenes::Default();
+    } else if (sceneName.ends_with(".json")) {
+        scenePath = sceneName;
+    }
+
     Walnut::Application* app = new Walnut::Application(spec);
-    app->PushLayer<ExampleLayer>();
+    app->PushLayer(std::make_shared<ExampleLayer>(std::move(*scene), std::move(scenePath)));
     // app->SetMenubarCallback([app]() {
     //     if (ImGui::BeginMenu("File")) {
     //         if (ImGui::MenuItem("Exit")) {
@@ -0,0 +1,62 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <fmt/format.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Minimal assertions for the CTest executables. A failed `CHECK` prints where it failed and
+ * the test carries on, `main` returns @ref `Check::Result` so CTest sees the failure.
+ */
+namespace Check {
+
+inline int Failures = 0;
+
+inline int Result()
+{
+    if (Failures > 0) {
+        fmt::println(stderr, "{} check(s) failed", Failures);
+    }
+    return Failures > 0 ? 1 : 0;
+}
+
+/// @brief A fresh file in this test's own temporary directory.
+inline std::filesystem::path TempPath(std::string_view name)
+{
+    auto dir = std::filesystem::temp_directory_path() / "cherno-raytracer-test";
+    std::filesystem::create_directories(dir);
+
+    auto path = dir / name;
+    std::filesystem::remove(path);
+    return path;
+}
+
+inline std::filesystem::path WriteFile(std::string_view name, std::string_view bytes)
+{
+    auto path = TempPath(name);
+    std::ofstream(path, std::ios::binary).write(bytes.data(), (std::streamsize)bytes.size());
+    return path;
+}
+
+inline std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+} // namespace Check
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fmt::println(stderr, "{}:{}: CHECK({}) failed", __FILE__, __LINE__, #cond); \
+            Check::Failures++;                                                      \
+        }                                                                           \
+    } while (false)
+
+#endif // CHECK_H
@@ -0,0 +1,167 @@
+#include "Check.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath> // ldexp
+#include <cstdint>
+#include <cstring> // memcpy
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ImageIO.h"
+
+namespace {
+
+constexpr uint32_t Width = 3, Height = 2;
+
+/// @brief Distinct values per pixel and channel, row 0 at the bottom as rendered.
+std::vector<glm::vec4> TestImage()
+{
+    std::vector<glm::vec4> pixels;
+    for (uint32_t y = 0; y < Height; y++) {
+        for (uint32_t x = 0; x < Width; x++) {
+            float v = (float)(y * Width + x);
+            pixels.emplace_back(v + 0.25f, v + 0.5f, v + 0.75f, 1.0f / (v + 1.0f));
+        }
+    }
+    return pixels;
+}
+
+template <typename T>
+T Get(const std::string& bytes, size_t at)
+{
+    T value {};
+    if (at + sizeof(T) <= bytes.size()) {
+        std::memcpy(&value, bytes.data() + at, sizeof(T));
+    }
+    return value;
+}
+
+/// @brief Offset of the value of an EXR header attribute, walking the name, type, size records.
+std::optional<size_t> FindExrAttribute(const std::string& bytes, std::string_view name, std::string_view type)
+{
+    size_t at = 8;
+    while (at < bytes.size() && bytes[at] != '\0') {
+        std::string attrName = bytes.c_str() + at;
+        at += attrName.size() + 1;
+        std::string attrType = bytes.c_str() + at;
+        at += attrType.size() + 1;
+        auto size = Get<int32_t>(bytes, at);
+        at += sizeof(int32_t);
+
+        if (attrName == name && attrType == type) {
+            return at;
+        }
+        at += (size_t)size;
+    }
+    return std::nullopt;
+}
+
+void TestExr()
+{
+    auto pixels = TestImage();
+    auto path = Check::TempPath("image.exr");
+    CHECK(ImageIO::Write(path, Width, Height, pixels.data()));
+
+    const std::string bytes = Check::ReadFile(path);
+    CHECK(Get<int32_t>(bytes, 0) == 20000630);
+    CHECK(Get<int32_t>(bytes, 4) == 2);
+
+    // Four float channels sorted by name.
+    auto channels = FindExrAttribute(bytes, "channels", "chlist");
+    CHECK(channels);
+    if (channels) {
+        for (size_t c = 0; c < 4; c++) {
+            size_t entry = *channels + c * 18;
+            CHECK(bytes[entry] == "ABGR"[c] && bytes[entry + 1] == '\0');
+            CHECK(Get<int32_t>(bytes, entry + 2) == 2);
+        }
+    }
+
+    auto dataWindow = FindExrAttribute(bytes, "dataWindow", "box2i");
+    CHECK(dataWindow && Get<int32_t>(bytes, *dataWindow + 8) == (int32_t)Width - 1);
+    CHECK(dataWindow && Get<int32_t>(bytes, *dataWindow + 12) == (int32_t)Height - 1);
+    CHECK(FindExrAttribute(bytes, "compression", "compression"));
+    CHECK(FindExrAttribute(bytes, "displayWindow", "box2i"));
+
+    // The header ends with a null byte, then one offset per scanline, then the scanlines.
+    size_t headerEnd = 8;
+    while (headerEnd < bytes.size() && bytes[headerEnd] != '\0') {
+        headerEnd += std::strlen(bytes.c_str() + headerEnd) + 1;
+        headerEnd += std::strlen(bytes.c_str() + headerEnd) + 1;
+        headerEnd += sizeof(int32_t) + (size_t)Get<int32_t>(bytes, headerEnd);
+    }
+    size_t offsets = headerEnd + 1;
+    const size_t lineSize = 2 * sizeof(int32_t) + Width * 4 * sizeof(float);
+    CHECK(bytes.size() == offsets + Height * sizeof(uint64_t) + Height * lineSize);
+
+    for (uint32_t y = 0; y < Height; y++) {
+        auto line = (size_t)Get<uint64_t>(bytes, offsets + y * sizeof(uint64_t));
+        CHECK(line == offsets + Height * sizeof(uint64_t) + y * lineSize);
+        CHECK(Get<int32_t>(bytes, line) == (int32_t)y);
+        CHECK(Get<int32_t>(bytes, line + 4) == (int32_t)(Width * 4 * sizeof(float)));
+
+        // EXR's first line is the top, our last row. Channels are planar per line, A B G R.
+        const glm::vec4* row = pixels.data() + (Height - 1 - y) * Width;
+        for (uint32_t x = 0; x < Width; x++) {
+            size_t planar = line + 8 + x * sizeof(float);
+            CHECK(Get<float>(bytes, planar) == row[x].a);
+            CHECK(Get<float>(bytes, planar + Width * sizeof(float)) == row[x].b);
+            CHECK(Get<float>(bytes, planar + 2 * Width * sizeof(float)) == row[x].g);
+            CHECK(Get<float>(bytes, planar + 3 * Width * sizeof(float)) == row[x].r);
+        }
+    }
+}
+
+void TestHdr()
+{
+    auto pixels = TestImage();
+    pixels[0] = { 1.0f, 0.5f, 0.25f, 1.0f };
+    pixels[1] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    pixels[2] = { -1.0f, 2.0f, 0.0f, 1.0f };
+
+    auto path = Check::TempPath("image.hdr");
+    CHECK(ImageIO::Write(path, Width, Height, pixels.data()));
+
+    const std::string bytes = Check::ReadFile(path);
+    const std::string header = fmt::format("#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y {} +X {}\n", Height, Width);
+    CHECK(bytes.compare(0, header.size(), header) == 0);
+    CHECK(bytes.size() == header.size() + Width * Height * 4);
+
+    // Row 0 is the bottom, written last.
+    auto rgbe = [&](uint32_t x, uint32_t y) {
+        size_t at = header.size() + ((Height - 1 - y) * Width + x) * 4;
+        auto e = (uint8_t)bytes[at + 3];
+        auto decode = [&](int c) { return e == 0 ? 0.0f : std::ldexp((float)(uint8_t)bytes[at + c], e - 136); };
+        return glm::vec3(decode(0), decode(1), decode(2));
+    };
+
+    CHECK(rgbe(0, 0) == glm::vec3(1.0f, 0.5f, 0.25f));
+    CHECK(rgbe(1, 0) == glm::vec3(0.0f));
+    // Negative radiance is clamped to zero.
+    CHECK(rgbe(2, 0) == glm::vec3(0.0f, 2.0f, 0.0f));
+    // The top row, within the 8-bit mantissa's precision.
+    CHECK(glm::length(rgbe(1, 1) - glm::vec3(pixels[4])) < 4.5f / 128.0f);
+}
+
+void TestPaths()
+{
+    CHECK(ImageIO::IsHdrPath("a.exr") && ImageIO::IsHdrPath("a.hdr") && !ImageIO::IsHdrPath("a.png"));
+    CHECK(ImageIO::IsSupportedPath("a.png") && ImageIO::IsSupportedPath("a.jpg") && ImageIO::IsSupportedPath("a.exr"));
+    CHECK(!ImageIO::IsSupportedPath("a.gif") && !ImageIO::IsSupportedPath("a"));
+
+    auto pixels = TestImage();
+    CHECK(!ImageIO::Write(Check::TempPath("image.gif"), Width, Height, pixels.data()));
+    CHECK(!ImageIO::Write(Check::TempPath("missing") / "image.exr", Width, Height, pixels.data()));
+}
+
+} // namespace
+
+int main()
+{
+    TestExr();
+    TestHdr();
+    TestPaths();
+    return Check::Result();
+}
@@ -0,0 +1,165 @@
+#include "Check.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm> // min, reverse
+#include <bit> // endian
+#include <cmath> // isfinite
+#include <cstdint>
+#include <cstring> // memcpy
+#include <limits>
+#include <string>
+
+#include "MeshLoader.h"
+
+namespace {
+
+/// @brief Appends `value` in the given byte order.
+template <typename T>
+void Append(std::string& out, T value, bool littleEndian = true)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (littleEndian != (std::endian::native == std::endian::little)) {
+        std::reverse(std::begin(bytes), std::end(bytes));
+    }
+    out.append(bytes, sizeof(T));
+}
+
+/// @brief Header of a binary PLY with `vertex` x y z and a `face` list with the given count type.
+std::string PlyHeader(uint64_t vertices, uint64_t faces, bool littleEndian = true, std::string_view countType = "uchar")
+{
+    return fmt::format("ply\nformat binary_{}_endian 1.0\n"
+                       "element vertex {}\nproperty float x\nproperty float y\nproperty float z\n"
+                       "element face {}\nproperty list {} int vertex_indices\nend_header\n",
+        littleEndian ? "little" : "big", vertices, faces, countType);
+}
+
+/// @brief A unit quad as two triangles, in either byte order.
+std::string PlyQuad(bool littleEndian)
+{
+    std::string ply = PlyHeader(4, 1, littleEndian);
+    const float positions[] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0 };
+    for (float v : positions) {
+        Append(ply, v, littleEndian);
+    }
+    Append<uint8_t>(ply, 4);
+    for (int32_t i : { 0, 1, 2, 3 }) {
+        Append(ply, i, littleEndian);
+    }
+    return ply;
+}
+
+bool AllFinite(const MeshGeometry& mesh)
+{
+    for (auto& n : mesh.Normals) {
+        if (!std::isfinite(n.x) || !std::isfinite(n.y) || !std::isfinite(n.z)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestObj()
+{
+    const std::string obj = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n# comment\nvt 0 0\nf 1 2 3 4\n";
+
+    auto quad = MeshLoader::Load(Check::WriteFile("quad.obj", obj));
+    CHECK(quad && quad->Positions.size() == 4 && quad->Indices.size() == 6 && quad->Normals.empty());
+
+    // Without the last newline, with CRLF line ends and with negative indices.
+    auto noNewline = MeshLoader::Load(Check::WriteFile("no_newline.obj", obj.substr(0, obj.size() - 1)));
+    CHECK(noNewline && noNewline->Indices == quad->Indices);
+
+    auto crlf = MeshLoader::Load(Check::WriteFile("crlf.obj", "v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nf -3 -2 -1\r\n"));
+    CHECK(crlf && crlf->Indices == std::vector<uint32_t>({ 0, 1, 2 }));
+
+    // An unterminated last line ending exactly on the reader's 1 MiB block boundary.
+    std::string boundary = "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+    const std::string face = "f 1 2 3";
+    while (boundary.size() + face.size() < (1 << 20)) {
+        boundary += std::string(std::min<size_t>(99, (1 << 20) - boundary.size() - face.size() - 1), '#') + "\n";
+    }
+    boundary += face;
+    CHECK(boundary.size() == (1 << 20));
+    auto onBoundary = MeshLoader::Load(Check::WriteFile("boundary.obj", boundary));
+    CHECK(onBoundary && onBoundary->Indices.size() == 3);
+
+    // Normals, one of them zero, which must not turn into NaN.
+    auto normals = MeshLoader::Load(Check::WriteFile("normals.obj",
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 2\nvn 0 0 0\nf 1//1 2//1 3//2\n"));
+    CHECK(normals && normals->Normals.size() == 3 && AllFinite(*normals));
+    CHECK(normals && glm::length(normals->Normals[0] - glm::vec3(0, 0, 1)) < 1e-6f);
+
+    CHECK(!MeshLoader::Load(Check::WriteFile("bad_index.obj", "v 0 0 0\nf 1 2 3\n")));
+    CHECK(!MeshLoader::Load(Check::WriteFile("bad_number.obj", "v 0 zero 0\n")));
+    CHECK(!MeshLoader::Load(Check::WriteFile("line.obj", "v 0 0 0\nv 1 0 0\nf 1 2\n")));
+    CHECK(!MeshLoader::Load(Check::TempPath("missing.obj")));
+}
+
+void TestPly()
+{
+    auto little = MeshLoader::Load(Check::WriteFile("quad_le.ply", PlyQuad(true)));
+    auto big = MeshLoader::Load(Check::WriteFile("quad_be.ply", PlyQuad(false)));
+    CHECK(little && little->Positions.size() == 4 && little->Indices.size() == 6);
+    CHECK(little && big && little->Positions == big->Positions && little->Indices == big->Indices);
+
+    std::string quad = PlyQuad(true);
+    CHECK(!MeshLoader::Load(Check::WriteFile("truncated.ply", quad.substr(0, quad.size() - 3))));
+    CHECK(!MeshLoader::Load(Check::WriteFile("no_header_end.ply", "ply\nformat binary_little_endian 1.0\n")));
+    CHECK(!MeshLoader::Load(Check::WriteFile("ascii.ply", "ply\nformat ascii 1.0\nend_header\n")));
+
+    // Counts that cannot fit in the file are rejected before anything is allocated.
+    std::string body = quad.substr(PlyHeader(4, 1).size());
+    CHECK(!MeshLoader::Load(Check::WriteFile("many_vertices.ply", PlyHeader(4'000'000'000, 1) + body)));
+    CHECK(!MeshLoader::Load(Check::WriteFile("many_faces.ply", PlyHeader(4, std::numeric_limits<uint64_t>::max()) + body)));
+
+    // Negative, NaN and huge list lengths.
+    auto withListLength = [&](std::string_view name, std::string_view countType, auto count) {
+        std::string ply = PlyHeader(4, 1, true, countType) + body.substr(0, 4 * 12);
+        Append(ply, count);
+        for (int32_t i : { 0, 1, 2, 3 }) {
+            Append(ply, i);
+        }
+        return MeshLoader::Load(Check::WriteFile(name, ply));
+    };
+    CHECK(withListLength("list_ok.ply", "int", (int32_t)4));
+    CHECK(!withListLength("list_negative.ply", "int", (int32_t)-1));
+    CHECK(!withListLength("list_nan.ply", "float", std::numeric_limits<float>::quiet_NaN()));
+    CHECK(!withListLength("list_huge.ply", "float", 1e30f));
+    CHECK(!withListLength("list_fraction.ply", "float", 3.5f));
+
+    // Out of range vertex index.
+    std::string badIndex = PlyHeader(4, 1) + body.substr(0, 4 * 12);
+    Append<uint8_t>(badIndex, 3);
+    for (int32_t i : { 0, 1, 4 }) {
+        Append(badIndex, i);
+    }
+    CHECK(!MeshLoader::Load(Check::WriteFile("bad_index.ply", badIndex)));
+
+    // A zero normal takes the normal of its faces.
+    std::string normals = "ply\nformat binary_little_endian 1.0\nelement vertex 3\n"
+                          "property float x\nproperty float y\nproperty float z\n"
+                          "property float nx\nproperty float ny\nproperty float nz\n"
+                          "element face 1\nproperty list uchar int vertex_indices\nend_header\n";
+    const float vertices[] = { 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 1 };
+    for (float v : vertices) {
+        Append(normals, v);
+    }
+    Append<uint8_t>(normals, 3);
+    for (int32_t i : { 0, 1, 2 }) {
+        Append(normals, i);
+    }
+    auto repaired = MeshLoader::Load(Check::WriteFile("zero_normal.ply", normals));
+    CHECK(repaired && repaired->Normals.size() == 3 && AllFinite(*repaired));
+    CHECK(repaired && glm::length(repaired->Normals[0] - glm::vec3(0, 0, 1)) < 1e-6f);
+}
+
+} // namespace
+
+int main()
+{
+    TestObj();
+    TestPly();
+    return Check::Result();
+}
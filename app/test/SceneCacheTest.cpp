@@ -0,0 +1,218 @@
+#include "Check.h"
+
+#include <cmath> // sqrt
+#include <cstdint>
+#include <cstring> // memcmp, memcpy
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "Renderer.h"
+#include "SceneCache.h"
+#include "Scenes.h"
+
+namespace {
+
+constexpr uint32_t Width = 32, Height = 24;
+
+// Mirrors the layout in SceneCache.cpp, to damage files on purpose.
+constexpr size_t FileHeaderSize = 16, SectionHeaderSize = 24;
+constexpr size_t SectionOffsetField = 8, SectionSizeField = 16;
+
+/// @brief A tetrahedron with per vertex normals.
+MeshGeometry Tetrahedron()
+{
+    MeshGeometry geometry;
+    geometry.Positions = { { 1, 1, 1 }, { 1, -1, -1 }, { -1, 1, -1 }, { -1, -1, 1 } };
+    for (auto& p : geometry.Positions) {
+        geometry.Normals.push_back(p / std::sqrt(3.0f));
+    }
+    geometry.Indices = { 0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2 };
+    return geometry;
+}
+
+/// @brief Spheres and three instances of one geometry, with transforms and a second material.
+Scene TestScene()
+{
+    Scene scene = Scenes::Default();
+    auto geometry = std::make_shared<const MeshGeometry>(Tetrahedron());
+
+    for (int i = 0; i < 3; i++) {
+        auto& mesh = scene.Meshes.emplace_back();
+        mesh.Geometry = geometry;
+        mesh.MatIdx = i % (int)scene.Materials.size();
+        mesh.Scale = 0.5f + 0.25f * (float)i;
+        mesh.Rotation = { 10.0f * (float)i, 20.0f, 0.0f };
+        mesh.Offset = { 2.0f * (float)i - 2.0f, 0.5f, -1.0f };
+    }
+    return scene;
+}
+
+/// @brief One frame of `scene`, with the BVHs of an earlier render if given.
+std::vector<uint32_t> Render(const Scene& scene, const SceneCache::CachedScene* accel = nullptr, Renderer* renderer = nullptr)
+{
+    Renderer local;
+    Renderer& r = renderer ? *renderer : local;
+    r.OnResize(Width, Height);
+    r.SetScene(std::make_shared<const Scene>(scene));
+    if (accel) {
+        r.SetAccel(accel->SphereBVH, accel->GeometryBVHs);
+    }
+
+    Camera camera(45.0f, 0.1f, 100.0f);
+    camera.OnResize(Width, Height);
+    r.Render(camera);
+
+    std::vector<uint32_t> image;
+    r.GetImage(image);
+    return image;
+}
+
+/// @brief Saves `saved` with the BVHs built for `built`, which may differ in what the BVHs do not cover.
+std::filesystem::path Save(std::string_view name, const Scene& saved, const Scene& built)
+{
+    Renderer renderer;
+    Render(built, nullptr, &renderer);
+
+    auto path = Check::TempPath(name);
+    CHECK(SceneCache::Save(path, saved, renderer.GetSphereBVH(), renderer.GetGeometryBVHs()));
+    return path;
+}
+
+bool SameNodes(const BVH& a, const BVH& b)
+{
+    auto &na = a.GetNodes(), &nb = b.GetNodes();
+    return na.size() == nb.size() && std::memcmp(na.data(), nb.data(), na.size() * sizeof(BVHNode)) == 0
+        && a.GetPrimIndices() == b.GetPrimIndices();
+}
+
+void TestRoundTrip()
+{
+    Scene scene = TestScene();
+
+    Renderer renderer;
+    auto image = Render(scene, nullptr, &renderer);
+    auto path = Check::TempPath("round_trip.rtsc");
+    CHECK(SceneCache::Save(path, scene, renderer.GetSphereBVH(), renderer.GetGeometryBVHs()));
+
+    auto cached = SceneCache::Load(path);
+    CHECK(cached);
+    if (!cached) {
+        return;
+    }
+
+    auto& loaded = cached->Contents;
+    CHECK(loaded.Materials == scene.Materials);
+    CHECK(loaded.Spheres == scene.Spheres);
+    CHECK(loaded.Meshes.size() == scene.Meshes.size());
+
+    for (size_t i = 0; i < std::min(loaded.Meshes.size(), scene.Meshes.size()); i++) {
+        auto &a = loaded.Meshes[i], &b = scene.Meshes[i];
+        CHECK(a.MatIdx == b.MatIdx && a.Scale == b.Scale && a.Rotation == b.Rotation && a.Offset == b.Offset);
+        CHECK(a.Geometry->Positions == b.Geometry->Positions && a.Geometry->Normals == b.Geometry->Normals);
+        CHECK(a.Geometry->Indices == b.Geometry->Indices);
+        // Shared geometry stays shared.
+        CHECK(a.Geometry == loaded.Meshes[0].Geometry);
+    }
+
+    CHECK(SameNodes(cached->SphereBVH, renderer.GetSphereBVH()));
+    CHECK(cached->GeometryBVHs.size() == 1);
+    CHECK(cached->GeometryBVHs.size() == 1 && SameNodes(cached->GeometryBVHs[0], renderer.GetGeometryBVHs()[0]));
+
+    // The cached BVHs render the same image as freshly built ones.
+    CHECK(Render(loaded, &*cached) == image);
+}
+
+void TestDamaged()
+{
+    auto path = Save("valid.rtsc", TestScene(), TestScene());
+    const std::string valid = Check::ReadFile(path);
+    CHECK(SceneCache::Load(path));
+
+    uint32_t sectionCount;
+    std::memcpy(&sectionCount, valid.data() + 8, sizeof(sectionCount));
+    CHECK(sectionCount > 0 && FileHeaderSize + sectionCount * SectionHeaderSize < valid.size());
+
+    auto loads = [](std::string_view name, const std::string& bytes) {
+        return SceneCache::Load(Check::WriteFile(name, bytes)).has_value();
+    };
+
+    auto patched = [&](size_t at, uint64_t value) {
+        std::string bytes = valid;
+        std::memcpy(bytes.data() + at, &value, sizeof(value));
+        return bytes;
+    };
+
+    // Every section moved past the end, grown past the end, or cut to a partial element.
+    for (uint32_t i = 0; i < sectionCount; i++) {
+        size_t header = FileHeaderSize + i * SectionHeaderSize;
+        uint64_t offset, size;
+        std::memcpy(&offset, valid.data() + header + SectionOffsetField, sizeof(offset));
+        std::memcpy(&size, valid.data() + header + SectionSizeField, sizeof(size));
+
+        if (size > 0) {
+            CHECK(!loads("offset.rtsc", patched(header + SectionOffsetField, valid.size())));
+            CHECK(!loads("partial.rtsc", patched(header + SectionSizeField, size - 1)));
+        }
+        CHECK(!loads("offset_max.rtsc", patched(header + SectionOffsetField, std::numeric_limits<uint64_t>::max())));
+        CHECK(!loads("size.rtsc", patched(header + SectionSizeField, std::numeric_limits<uint64_t>::max() - 8)));
+        CHECK(offset % 16 == 0);
+    }
+
+    CHECK(!loads("truncated.rtsc", valid.substr(0, valid.size() / 2)));
+    CHECK(!loads("header_only.rtsc", valid.substr(0, FileHeaderSize)));
+    CHECK(!loads("empty.rtsc", ""));
+    CHECK(!loads("sections.rtsc", patched(8, 0xffffffffull | ((uint64_t)0x01020304 << 32))));
+
+    std::string version = valid;
+    version[4]++;
+    CHECK(!loads("version.rtsc", version));
+
+    std::string magic = valid;
+    magic[0] = 'X';
+    CHECK(!loads("magic.rtsc", magic));
+
+    // Flipped bytes anywhere must fail cleanly or load something valid, never crash.
+    for (size_t at = 0; at < valid.size(); at += 7) {
+        std::string bytes = valid;
+        bytes[at] = (char)~bytes[at];
+        loads("flipped.rtsc", bytes);
+    }
+}
+
+void TestInvalidTransforms()
+{
+    // The BVHs do not depend on the instance transforms, so they are built from the valid scene.
+    Scene valid = TestScene();
+
+    Scene zeroScale = valid;
+    zeroScale.Meshes[1].Scale = 0.0f;
+    CHECK(!SceneCache::Load(Save("zero_scale.rtsc", zeroScale, valid)));
+
+    Scene nanScale = valid;
+    nanScale.Meshes[1].Scale = std::numeric_limits<float>::quiet_NaN();
+    CHECK(!SceneCache::Load(Save("nan_scale.rtsc", nanScale, valid)));
+
+    Scene infOffset = valid;
+    infOffset.Meshes[2].Offset.y = std::numeric_limits<float>::infinity();
+    CHECK(!SceneCache::Load(Save("inf_offset.rtsc", infOffset, valid)));
+
+    Scene nanRotation = valid;
+    nanRotation.Meshes[0].Rotation.x = std::numeric_limits<float>::quiet_NaN();
+    CHECK(!SceneCache::Load(Save("nan_rotation.rtsc", nanRotation, valid)));
+
+    Scene badMaterial = valid;
+    badMaterial.Meshes[0].MatIdx = (int)valid.Materials.size();
+    CHECK(!SceneCache::Load(Save("bad_material.rtsc", badMaterial, valid)));
+}
+
+} // namespace
+
+int main()
+{
+    TestRoundTrip();
+    TestDamaged();
+    TestInvalidTransforms();
+    return Check::Result();
+}
@@ -0,0 +1,134 @@
+#include "Check.h"
+
+#include <limits>
+#include <string>
+
+#include "MeshLoader.h"
+#include "SceneFile.h"
+#include "Scenes.h"
+
+namespace {
+
+/// @brief Default scene plus two meshes placing one OBJ file, every mesh field off its default.
+Scene TestScene()
+{
+    auto obj = Check::WriteFile("triangle.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+    auto geometry = std::make_shared<const MeshGeometry>(*MeshLoader::Load(obj));
+
+    Scene scene = Scenes::Default();
+    scene.Materials[0].Roughness = 0.1f;
+    scene.Materials[0].EmissionPower = 1.0f / 3.0f;
+
+    for (int i = 0; i < 2; i++) {
+        auto& mesh = scene.Meshes.emplace_back();
+        mesh.Geometry = geometry;
+        mesh.Source = obj;
+        mesh.MatIdx = i;
+        mesh.Scale = 0.1f * (float)(i + 1);
+        mesh.Rotation = { 0.0f, 33.3f, 1e-7f };
+        mesh.Offset = { -1.0f / 7.0f, 2.0f, 1e6f };
+    }
+    return scene;
+}
+
+std::optional<Scene> LoadJson(std::string_view name, std::string_view json)
+{
+    return SceneFile::Load(Check::WriteFile(name, json));
+}
+
+void TestRoundTrip()
+{
+    Scene scene = TestScene();
+    auto path = Check::TempPath("round_trip.json");
+    CHECK(SceneFile::Save(path, scene));
+
+    auto loaded = SceneFile::Load(path);
+    CHECK(loaded);
+    if (!loaded) {
+        return;
+    }
+
+    // Floats are written so that they read back exactly.
+    CHECK(loaded->Materials == scene.Materials);
+    CHECK(loaded->Spheres == scene.Spheres);
+    CHECK(loaded->Meshes.size() == scene.Meshes.size());
+    for (size_t i = 0; i < std::min(loaded->Meshes.size(), scene.Meshes.size()); i++) {
+        auto &a = loaded->Meshes[i], &b = scene.Meshes[i];
+        CHECK(a.Scale == b.Scale && a.Rotation == b.Rotation && a.Offset == b.Offset && a.MatIdx == b.MatIdx);
+        CHECK(std::filesystem::equivalent(a.Source, b.Source));
+        CHECK(a.Geometry->Positions == b.Geometry->Positions && a.Geometry->Indices == b.Geometry->Indices);
+        // One file, one geometry.
+        CHECK(a.Geometry == loaded->Meshes[0].Geometry);
+    }
+
+    // Saving what was loaded gives the same file.
+    auto again = Check::TempPath("round_trip_again.json");
+    CHECK(SceneFile::Save(again, *loaded));
+    CHECK(Check::ReadFile(path) == Check::ReadFile(again));
+
+    // Reloading the unchanged file changes nothing and keeps the geometry.
+    Scene current = *loaded;
+    auto geometry = current.Meshes[0].Geometry;
+    auto unchanged = SceneFile::Reload(path, current);
+    CHECK(unchanged && !unchanged->Any() && current.Meshes[0].Geometry == geometry);
+
+    // A moved sphere is all that differs.
+    Scene moved = *loaded;
+    moved.Spheres[1].Pos.x += 1.0f;
+    CHECK(SceneFile::Save(path, moved));
+    auto changes = SceneFile::Reload(path, current);
+    CHECK(changes && changes->MovedSpheres == std::vector<uint32_t>({ 1 }) && !changes->Meshes && !changes->Shading);
+    CHECK(current.Spheres == moved.Spheres);
+}
+
+void TestInvalid()
+{
+    const std::string material = R"("materials": [ { "albedo": [1, 1, 1] } ])";
+    auto withSpheres = [&](std::string_view spheres) {
+        return fmt::format(R"({{ {}, "spheres": [ {} ] }})", material, spheres);
+    };
+
+    CHECK(LoadJson("valid.json", withSpheres(R"({ "position": [0, 0, 0], "radius": 1 })")));
+    CHECK(LoadJson("comments.json", "// comment\n" + withSpheres(R"({ "radius": 2 /* inline */ })")));
+
+    // 1e39 does not fit a float and reads as infinity.
+    CHECK(!LoadJson("inf_position.json", withSpheres(R"({ "position": [1e39, 0, 0], "radius": 1 })")));
+    CHECK(!LoadJson("inf_radius.json", withSpheres(R"({ "radius": 1e39 })")));
+    CHECK(!LoadJson("zero_radius.json", withSpheres(R"({ "radius": 0 })")));
+    CHECK(!LoadJson("negative_radius.json", withSpheres(R"({ "radius": -1 })")));
+    CHECK(!LoadJson("no_material.json", withSpheres(R"({ "radius": 1, "material": 1 })")));
+    CHECK(!LoadJson("inf_emission.json", R"({ "materials": [ { "emissionPower": 1e39 } ] })"));
+
+    auto obj = Check::WriteFile("mesh.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+    auto withMesh = [&](std::string_view fields) {
+        return fmt::format(R"({{ {}, "meshes": [ {{ "file": "{}" {} }} ] }})", material, obj.filename().string(), fields);
+    };
+    CHECK(LoadJson("mesh.json", withMesh(R"(, "scale": 2)")));
+    CHECK(!LoadJson("zero_scale.json", withMesh(R"(, "scale": 0)")));
+    CHECK(!LoadJson("inf_offset.json", withMesh(R"(, "offset": [0, -1e39, 0])")));
+    CHECK(!LoadJson("missing_mesh.json", fmt::format(R"({{ {}, "meshes": [ {{ "file": "missing.obj" }} ] }})", material)));
+
+    CHECK(!LoadJson("syntax.json", R"({ "spheres": [ )"));
+    CHECK(!LoadJson("array.json", "[]"));
+    CHECK(!SceneFile::Load(Check::TempPath("missing.json")));
+
+    // JSON has no NaN or infinity, such scenes are not saved at all.
+    Scene scene = Scenes::Default();
+    auto path = Check::TempPath("not_saved.json");
+
+    scene.Spheres[0].Radius = std::numeric_limits<float>::quiet_NaN();
+    CHECK(!SceneFile::Save(path, scene) && !std::filesystem::exists(path));
+
+    scene = Scenes::Default();
+    scene.Materials[0].Albedo.g = std::numeric_limits<float>::infinity();
+    CHECK(!SceneFile::Save(path, scene) && !std::filesystem::exists(path));
+}
+
+} // namespace
+
+int main()
+{
+    TestRoundTrip();
+    TestInvalid();
+    return Check::Result();
+}
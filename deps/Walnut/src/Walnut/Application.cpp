@@ -1,4 +1,5 @@
 #include "Application.h"
+#include "Profiler.h"
 
 //
 // Adapted from Dear ImGui Vulkan example
@@ -14,6 +15,7 @@
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <iostream>
 
 // Emedded font
@@ -55,6 +57,14 @@ static std::vector<std::vector<std::function<void()>>> s_ResourceFreeQueue;
 // and is always guaranteed to increase (eg. 0, 1, 2, 0, 1, 2)
 static uint32_t s_CurrentFrameIndex = 0;
 
+// Commands recorded at the start of the next frame's command buffer, see Application::SubmitFrameCommands
+static std::vector<std::function<void(VkCommandBuffer)>> s_FrameCommandQueue;
+// Monotonic frame numbers, 0 means "never submitted"
+static uint64_t s_FrameNumber = 1;
+static uint64_t s_CompletedFrame = 0;
+// Frame number last submitted with each swapchain image's command buffer
+static std::vector<uint64_t> s_SubmittedFrameNumbers;
+
 static Walnut::Application* s_Instance = nullptr;
 
 void check_vk_result(VkResult err)
@@ -293,6 +303,10 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
 
 		err = vkResetFences(g_Device, 1, &fd->Fence);
 		check_vk_result(err);
+
+		// A single queue completes in submission order, so everything up to this frame is done
+		if (wd->FrameIndex < s_SubmittedFrameNumbers.size())
+			s_CompletedFrame = std::max(s_CompletedFrame, s_SubmittedFrameNumbers[wd->FrameIndex]);
 	}
 
 	{
@@ -319,6 +333,12 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
 		err = vkBeginCommandBuffer(fd->CommandBuffer, &info);
 		check_vk_result(err);
 	}
+	{
+		// Uploads and other transfers queued during this frame, they must run outside the render pass
+		for (auto& func : s_FrameCommandQueue)
+			func(fd->CommandBuffer);
+		s_FrameCommandQueue.clear();
+	}
 	{
 		VkRenderPassBeginInfo info = {};
 		info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -352,6 +372,10 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
 		check_vk_result(err);
 		err = vkQueueSubmit(g_Queue, 1, &info, fd->Fence);
 		check_vk_result(err);
+
+		if (s_SubmittedFrameNumbers.size() < wd->ImageCount)
+			s_SubmittedFrameNumbers.resize(wd->ImageCount, 0);
+		s_SubmittedFrameNumbers[wd->FrameIndex] = s_FrameNumber++;
 	}
 }
 
@@ -530,6 +554,9 @@ namespace Walnut {
 		VkResult err = vkDeviceWaitIdle(g_Device);
 		check_vk_result(err);
 
+		// Never submitted, the images they target are about to be freed
+		s_FrameCommandQueue.clear();
+
 		// Free resources in queue
 		for (auto& queue : s_ResourceFreeQueue)
 		{
@@ -559,9 +586,13 @@ namespace Walnut {
 		ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 		ImGuiIO& io = ImGui::GetIO();
 
+		Profiler::SetThreadName("Main");
+
 		// Main loop
 		while (!glfwWindowShouldClose(m_WindowHandle) && m_Running)
 		{
+			Profiler::BeginFrame();
+
 			// Poll and handle events (inputs, window resize, etc.)
 			// You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
 			// - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application.
@@ -569,8 +600,11 @@ namespace Walnut {
 			// Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
 			glfwPollEvents();
 
-			for (auto& layer : m_LayerStack)
-				layer->OnUpdate(m_TimeStep);
+			{
+				WL_PROFILE_SCOPE("Layer::OnUpdate");
+				for (auto& layer : m_LayerStack)
+					layer->OnUpdate(m_TimeStep);
+			}
 
 			// Resize swap chain?
 			if (g_SwapChainRebuild)
@@ -592,9 +626,12 @@ namespace Walnut {
 			}
 
 			// Start the Dear ImGui frame
-			ImGui_ImplVulkan_NewFrame();
-			ImGui_ImplGlfw_NewFrame();
-			ImGui::NewFrame();
+			{
+				WL_PROFILE_SCOPE("ImGui::NewFrame");
+				ImGui_ImplVulkan_NewFrame();
+				ImGui_ImplGlfw_NewFrame();
+				ImGui::NewFrame();
+			}
 
 			{
 				static ImGuiDockNodeFlags dockspace_flags = ImGuiDockNodeFlags_None;
@@ -647,6 +684,7 @@ namespace Walnut {
 					}
 				}
 
+				WL_PROFILE_SCOPE("Layer::OnUIRender");
 				for (auto& layer : m_LayerStack)
 					layer->OnUIRender();
 
@@ -654,7 +692,10 @@ namespace Walnut {
 			}
 
 			// Rendering
-			ImGui::Render();
+			{
+				WL_PROFILE_SCOPE("ImGui::Render");
+				ImGui::Render();
+			}
 			ImDrawData* main_draw_data = ImGui::GetDrawData();
 			const bool main_is_minimized = (main_draw_data->DisplaySize.x <= 0.0f || main_draw_data->DisplaySize.y <= 0.0f);
 			wd->ClearValue.color.float32[0] = clear_color.x * clear_color.w;
@@ -662,7 +703,10 @@ namespace Walnut {
 			wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
 			wd->ClearValue.color.float32[3] = clear_color.w;
 			if (!main_is_minimized)
+			{
+				WL_PROFILE_SCOPE("FrameRender");
 				FrameRender(wd, main_draw_data);
+			}
 
 			// Update and Render additional Platform Windows
 			if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
@@ -673,7 +717,10 @@ namespace Walnut {
 
 			// Present Main Platform Window
 			if (!main_is_minimized)
+			{
+				WL_PROFILE_SCOPE("FramePresent");
 				FramePresent(wd);
+			}
 
 			float time = GetTime();
 			m_FrameTime = time - m_LastFrameTime;
@@ -767,4 +814,33 @@ namespace Walnut {
 		s_ResourceFreeQueue[s_CurrentFrameIndex].emplace_back(func);
 	}
 
+	uint64_t Application::SubmitFrameCommands(std::function<void(VkCommandBuffer)>&& func)
+	{
+		s_FrameCommandQueue.emplace_back(std::move(func));
+		return s_FrameNumber;
+	}
+
+	uint64_t Application::GetFrameNumber()
+	{
+		return s_FrameNumber;
+	}
+
+	uint64_t Application::GetCompletedFrame()
+	{
+		return s_CompletedFrame;
+	}
+
+	uint32_t Application::GetFramesInFlight()
+	{
+		return g_MainWindowData.ImageCount;
+	}
+
+	void Application::WaitForGPU()
+	{
+		VkResult err = vkDeviceWaitIdle(g_Device);
+		check_vk_result(err);
+
+		s_CompletedFrame = s_FrameNumber - 1;
+	}
+
 }
@@ -55,6 +55,17 @@ namespace Walnut {
 		static VkCommandBuffer GetCommandBuffer(bool begin);
 		static void FlushCommandBuffer(VkCommandBuffer commandBuffer);
 
+		// Record commands into the next frame's command buffer, ahead of the ImGui render pass.
+		// Nothing blocks, check GetCompletedFrame() against the returned frame number instead.
+		static uint64_t SubmitFrameCommands(std::function<void(VkCommandBuffer)>&& func);
+		// Number of the frame that is currently being built, its commands are not submitted yet
+		static uint64_t GetFrameNumber();
+		// Every frame up to and including this one has finished executing on the GPU
+		static uint64_t GetCompletedFrame();
+		static uint32_t GetFramesInFlight();
+		// Blocks until the GPU is idle, every submitted frame is then complete
+		static void WaitForGPU();
+
 		static void SubmitResourceFree(std::function<void()>&& func);
 	private:
 		void Init();
@@ -4,14 +4,14 @@
 #include "imgui_impl_vulkan.h"
 
 #include "Application.h"
+#include "Profiler.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
 #include <fmt/format.h>
+
+#include <algorithm>
 namespace Walnut {
 
 	namespace Utils {
@@ -165,7 +165,7 @@ namespace Walnut {
 	void Image::Release()
 	{
 		Application::SubmitResourceFree([sampler = m_Sampler, imageView = m_ImageView, image = m_Image,
-			memory = m_Memory, stagingBuffer = m_StagingBuffer, stagingBufferMemory = m_StagingBufferMemory]()
+			memory = m_Memory, stagingBuffers = std::move(m_StagingBuffers)]()
 		{
 			VkDevice device = Application::GetDevice();
 
@@ -173,72 +173,125 @@ namespace Walnut {
 			vkDestroyImageView(device, imageView, nullptr);
 			vkDestroyImage(device, image, nullptr);
 			vkFreeMemory(device, memory, nullptr);
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+			for (auto& staging : stagingBuffers)
+			{
+				vkUnmapMemory(device, staging.Memory);
+				vkDestroyBuffer(device, staging.Buffer, nullptr);
+				vkFreeMemory(device, staging.Memory, nullptr);
+			}
 		});
 
 		m_Sampler = nullptr;
 		m_ImageView = nullptr;
 		m_Image = nullptr;
 		m_Memory = nullptr;
-		m_StagingBuffer = nullptr;
-		m_StagingBufferMemory = nullptr;
+		m_StagingBuffers.clear();
+		m_StagingIndex = 0;
+		m_PendingFrame = 0;
 	}
 
-	void Image::SetData(const void* data)
+	void Image::AllocateStagingBuffers(uint64_t size)
 	{
 		VkDevice device = Application::GetDevice();
 
-		size_t upload_size = m_Width * m_Height * Utils::BytesPerPixel(m_Format);
-
 		VkResult err;
 
-		if (!m_StagingBuffer)
-		{
-			// Create the Upload Buffer
-			{
-				VkBufferCreateInfo buffer_info = {};
-				buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-				buffer_info.size = upload_size;
-				buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-				buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-				err = vkCreateBuffer(device, &buffer_info, nullptr, &m_StagingBuffer);
-				check_vk_result(err);
-				VkMemoryRequirements req;
-				vkGetBufferMemoryRequirements(device, m_StagingBuffer, &req);
-				m_AlignedSize = req.size;
-				VkMemoryAllocateInfo alloc_info = {};
-				alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				alloc_info.allocationSize = req.size;
-				alloc_info.memoryTypeIndex = Utils::GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-				err = vkAllocateMemory(device, &alloc_info, nullptr, &m_StagingBufferMemory);
-				check_vk_result(err);
-				err = vkBindBufferMemory(device, m_StagingBuffer, m_StagingBufferMemory, 0);
-				check_vk_result(err);
-			}
-
-		}
+		m_StagingBuffers.resize(std::max(2u, Application::GetFramesInFlight() + 1));
 
-		// Upload to Buffer
+		for (auto& staging : m_StagingBuffers)
 		{
-			char* map = NULL;
-			err = vkMapMemory(device, m_StagingBufferMemory, 0, m_AlignedSize, 0, (void**)(&map));
+			VkBufferCreateInfo buffer_info = {};
+			buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			buffer_info.size = size;
+			buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			err = vkCreateBuffer(device, &buffer_info, nullptr, &staging.Buffer);
+			check_vk_result(err);
+			VkMemoryRequirements req;
+			vkGetBufferMemoryRequirements(device, staging.Buffer, &req);
+			m_AlignedSize = req.size;
+			VkMemoryAllocateInfo alloc_info = {};
+			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			alloc_info.allocationSize = req.size;
+			alloc_info.memoryTypeIndex = Utils::GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
+			err = vkAllocateMemory(device, &alloc_info, nullptr, &staging.Memory);
 			check_vk_result(err);
-			memcpy(map, data, upload_size);
-			VkMappedMemoryRange range[1] = {};
-			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-			range[0].memory = m_StagingBufferMemory;
-			range[0].size = m_AlignedSize;
-			err = vkFlushMappedMemoryRanges(device, 1, range);
+			err = vkBindBufferMemory(device, staging.Buffer, staging.Memory, 0);
+			check_vk_result(err);
+
+			// Stays mapped until Release()
+			err = vkMapMemory(device, staging.Memory, 0, m_AlignedSize, 0, &staging.Mapped);
 			check_vk_result(err);
-			vkUnmapMemory(device, m_StagingBufferMemory);
 		}
 
+		m_StagingIndex = 0;
+	}
 
-		// Copy to Image
-		{
-			VkCommandBuffer command_buffer = Application::GetCommandBuffer(true);
+	Image::StagingBuffer& Image::AcquireStagingBuffer()
+	{
+		// Copy is recorded but not submitted yet, so its buffer can simply be overwritten
+		if (m_PendingFrame == Application::GetFrameNumber())
+			return m_StagingBuffers[m_StagingIndex];
+
+		m_StagingIndex = (m_StagingIndex + 1) % (uint32_t)m_StagingBuffers.size();
+		StagingBuffer& staging = m_StagingBuffers[m_StagingIndex];
+
+		// Only when more frames are in flight than there are buffers, e.g. after a swapchain rebuild
+		if (staging.Frame > Application::GetCompletedFrame())
+			Application::WaitForGPU();
+
+		return staging;
+	}
+
+	void Image::SetData(const void* data)
+	{
+		WL_PROFILE_SCOPE("Image::SetData");
+
+		size_t upload_size = m_Width * m_Height * Utils::BytesPerPixel(m_Format);
 
+		memcpy(BeginUpload(), data, upload_size);
+		EndUpload();
+	}
+
+	void* Image::BeginUpload()
+	{
+		WL_PROFILE_SCOPE("Image::BeginUpload");
+
+		size_t upload_size = m_Width * m_Height * Utils::BytesPerPixel(m_Format);
+
+		if (m_StagingBuffers.empty())
+			AllocateStagingBuffers(upload_size);
+
+		return AcquireStagingBuffer().Mapped;
+	}
+
+	void Image::EndUpload()
+	{
+		WL_PROFILE_SCOPE("Image::EndUpload");
+
+		VkDevice device = Application::GetDevice();
+
+		StagingBuffer& staging = m_StagingBuffers[m_StagingIndex];
+
+		VkMappedMemoryRange range[1] = {};
+		range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range[0].memory = staging.Memory;
+		range[0].size = VK_WHOLE_SIZE;
+		VkResult err = vkFlushMappedMemoryRanges(device, 1, range);
+		check_vk_result(err);
+
+		// Already queued when this frame uploaded before
+		if (m_PendingFrame != Application::GetFrameNumber())
+			QueueUpload(staging);
+	}
+
+	void Image::QueueUpload(StagingBuffer& staging)
+	{
+		// Copy to Image, recorded into the frame's command buffer, no fence wait
+		staging.Frame = m_PendingFrame = Application::SubmitFrameCommands(
+			[image = m_Image, buffer = staging.Buffer, width = m_Width, height = m_Height](VkCommandBuffer command_buffer)
+		{
 			VkImageMemoryBarrier copy_barrier = {};
 			copy_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 			copy_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
@@ -246,7 +299,7 @@ namespace Walnut {
 			copy_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 			copy_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 			copy_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			copy_barrier.image = m_Image;
+			copy_barrier.image = image;
 			copy_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			copy_barrier.subresourceRange.levelCount = 1;
 			copy_barrier.subresourceRange.layerCount = 1;
@@ -255,10 +308,10 @@ namespace Walnut {
 			VkBufferImageCopy region = {};
 			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			region.imageSubresource.layerCount = 1;
-			region.imageExtent.width = m_Width;
-			region.imageExtent.height = m_Height;
+			region.imageExtent.width = width;
+			region.imageExtent.height = height;
 			region.imageExtent.depth = 1;
-			vkCmdCopyBufferToImage(command_buffer, m_StagingBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
 			VkImageMemoryBarrier use_barrier = {};
 			use_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -268,14 +321,12 @@ namespace Walnut {
 			use_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 			use_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 			use_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			use_barrier.image = m_Image;
+			use_barrier.image = image;
 			use_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			use_barrier.subresourceRange.levelCount = 1;
 			use_barrier.subresourceRange.layerCount = 1;
 			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &use_barrier);
-
-			Application::FlushCommandBuffer(command_buffer);
-		}
+		});
 	}
 
 	void Image::Resize(uint32_t width, uint32_t height)
@@ -291,19 +342,4 @@ namespace Walnut {
 		Release();
 		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
 	}
-
-	void Image::SaveToBmp(const char* filename) const
-	{
-		VkResult err;
-		VkDevice device = Application::GetDevice();
-
-		void* imgData = nullptr;
-		err = vkMapMemory(device, m_StagingBufferMemory, 0, m_AlignedSize, 0, (void**)(&imgData));
-		check_vk_result(err);
-
-		// Bug: Writing to file may take too long.
-		stbi_write_bmp(filename, m_Width, m_Height, 4, imgData);
-
-		vkUnmapMemory(device, m_StagingBufferMemory);
-	}
 }
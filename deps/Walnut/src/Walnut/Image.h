@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "vulkan/vulkan.h"
 
@@ -22,6 +23,11 @@ namespace Walnut {
 
 		void SetData(const void* data);
 
+		// Zero-copy alternative to SetData: write width * height pixels straight into the returned
+		// staging memory, then call EndUpload. Memory may be write-combined, avoid reading from it.
+		void* BeginUpload();
+		void EndUpload();
+
 		VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
 
 		void Resize(uint32_t width, uint32_t height);
@@ -29,11 +35,25 @@ namespace Walnut {
 		uint32_t GetWidth() const { return m_Width; }
 		uint32_t GetHeight() const { return m_Height; }
 
-        void SaveToBmp(const char* filename) const;
-
 	private:
+		// Host visible buffer the pixels are written to, persistently mapped
+		struct StagingBuffer
+		{
+			VkBuffer Buffer = nullptr;
+			VkDeviceMemory Memory = nullptr;
+			void* Mapped = nullptr;
+			// Frame the last copy out of this buffer was submitted with, see Application::GetFrameNumber
+			uint64_t Frame = 0;
+		};
+
 		void AllocateMemory(uint64_t size);
+		void AllocateStagingBuffers(uint64_t size);
 		void Release();
+
+		// Next staging buffer the GPU is done with, or the one whose copy is still queued for this frame
+		StagingBuffer& AcquireStagingBuffer();
+		// Records the buffer to image copy into the current frame's command buffer
+		void QueueUpload(StagingBuffer& staging);
         
 	private:
 		uint32_t m_Width = 0, m_Height = 0;
@@ -45,8 +65,11 @@ namespace Walnut {
 
 		ImageFormat m_Format = ImageFormat::None;
 
-		VkBuffer m_StagingBuffer = nullptr;
-		VkDeviceMemory m_StagingBufferMemory = nullptr;
+		// Ring of staging buffers, one more than the frames in flight, so uploads never wait on the GPU
+		std::vector<StagingBuffer> m_StagingBuffers;
+		uint32_t m_StagingIndex = 0;
+		// Frame number of the upload that is queued but not yet submitted
+		uint64_t m_PendingFrame = 0;
 
 		size_t m_AlignedSize = 0;
 
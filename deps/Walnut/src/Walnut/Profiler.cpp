@@ -0,0 +1,253 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace Walnut {
+
+	namespace {
+
+		using Clock = std::chrono::steady_clock;
+
+		const Clock::time_point s_Epoch = Clock::now();
+
+		// One ring entry, a seqlock: Seq is 2 * index + 1 while the event with that index is written and
+		// 2 * index + 2 once it is complete. The fields are atomics so that a reader racing the writer
+		// is not undefined behaviour, relaxed accesses compile to plain loads and stores.
+		struct EventSlot
+		{
+			std::atomic<uint64_t> Seq { 0 };
+			std::atomic<const char*> Name { nullptr };
+			std::atomic<uint64_t> Start { 0 }, End { 0 };
+			std::atomic<uint32_t> Depth { 0 };
+		};
+
+		struct ThreadBuffer
+		{
+			uint32_t Id = 0;
+			// Guarded by s_RegistryMutex
+			std::string Name;
+			std::unique_ptr<EventSlot[]> Events { new EventSlot[Profiler::EventCapacity] };
+			// Events ever recorded, the latest one is at (Count - 1) % EventCapacity
+			std::atomic<uint64_t> Count { 0 };
+			std::atomic<bool> Owned { true };
+		};
+
+		std::mutex s_RegistryMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> s_Buffers;
+
+		// Hands the buffer back when its thread exits
+		struct ThreadSlot
+		{
+			ThreadBuffer* Buffer = nullptr;
+			// Set before the first event, the buffer is only allocated then
+			std::string Name;
+
+			~ThreadSlot()
+			{
+				if (Buffer)
+					Buffer->Owned.store(false, std::memory_order_release);
+			}
+		};
+
+		thread_local ThreadSlot s_Slot;
+
+		// Copies event `idx` unless the writer is overwriting it or already has
+		bool ReadEvent(const ThreadBuffer& buffer, uint64_t idx, ProfileEvent& event)
+		{
+			const EventSlot& slot = buffer.Events[idx % Profiler::EventCapacity];
+
+			uint64_t seq = slot.Seq.load(std::memory_order_acquire);
+			if (seq != 2 * idx + 2)
+				return false;
+
+			event.Name = slot.Name.load(std::memory_order_relaxed);
+			event.Start = slot.Start.load(std::memory_order_relaxed);
+			event.End = slot.End.load(std::memory_order_relaxed);
+			event.Depth = slot.Depth.load(std::memory_order_relaxed);
+
+			// Orders the field loads before the re-check, a changed Seq means they may be torn
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return slot.Seq.load(std::memory_order_relaxed) == seq;
+		}
+
+		std::atomic<uint64_t> s_FrameStart { 0 };
+		std::atomic<uint64_t> s_LastFrameStart { 0 };
+
+		ThreadBuffer& GetThreadBuffer()
+		{
+			if (s_Slot.Buffer)
+				return *s_Slot.Buffer;
+
+			std::lock_guard<std::mutex> lock(s_RegistryMutex);
+
+			// Reuse the buffer of an exited thread, thread pools are recreated when their size changes
+			for (auto& buffer : s_Buffers)
+			{
+				if (!buffer->Owned.load(std::memory_order_acquire))
+				{
+					buffer->Owned.store(true, std::memory_order_relaxed);
+					buffer->Name = s_Slot.Name;
+					s_Slot.Buffer = buffer.get();
+					return *s_Slot.Buffer;
+				}
+			}
+
+			auto& buffer = s_Buffers.emplace_back(std::make_unique<ThreadBuffer>());
+			buffer->Id = (uint32_t)s_Buffers.size() - 1;
+			buffer->Name = s_Slot.Name;
+			s_Slot.Buffer = buffer.get();
+			return *s_Slot.Buffer;
+		}
+
+		void WriteJsonString(std::ostream& out, const std::string& str)
+		{
+			out << '"';
+			for (char c : str)
+			{
+				if (c == '"' || c == '\\')
+					out << '\\' << c;
+				else if ((unsigned char)c < 0x20)
+					out << ' ';
+				else
+					out << c;
+			}
+			out << '"';
+		}
+
+	}
+
+	std::atomic<bool> Profiler::s_Enabled { false };
+	thread_local uint32_t ProfileScope::s_Depth = 0;
+
+	void Profiler::SetThreadName(const std::string& name)
+	{
+		s_Slot.Name = name;
+
+		if (s_Slot.Buffer)
+		{
+			std::lock_guard<std::mutex> lock(s_RegistryMutex);
+			s_Slot.Buffer->Name = name;
+		}
+	}
+
+	void Profiler::BeginFrame()
+	{
+		uint64_t now = Now();
+		s_LastFrameStart.store(s_FrameStart.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		s_FrameStart.store(now, std::memory_order_relaxed);
+	}
+
+	uint64_t Profiler::Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_Epoch).count();
+	}
+
+	void Profiler::Record(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+	{
+		auto& buffer = GetThreadBuffer();
+
+		// Only this thread writes. Readers skip the slot while its Seq is odd or belongs to another event.
+		uint64_t count = buffer.Count.load(std::memory_order_relaxed);
+		EventSlot& slot = buffer.Events[count % EventCapacity];
+		slot.Seq.store(2 * count + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.Name.store(name, std::memory_order_relaxed);
+		slot.Start.store(start, std::memory_order_relaxed);
+		slot.End.store(end, std::memory_order_relaxed);
+		slot.Depth.store(depth, std::memory_order_relaxed);
+		slot.Seq.store(2 * count + 2, std::memory_order_release);
+		buffer.Count.store(count + 1, std::memory_order_release);
+	}
+
+	std::vector<ProfileThread> Profiler::GetLastFrame()
+	{
+		return Collect(GetLastFrameStart(), GetLastFrameEnd());
+	}
+
+	uint64_t Profiler::GetLastFrameStart()
+	{
+		return s_LastFrameStart.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Profiler::GetLastFrameEnd()
+	{
+		return s_FrameStart.load(std::memory_order_relaxed);
+	}
+
+	std::vector<ProfileThread> Profiler::Collect(uint64_t from, uint64_t to)
+	{
+		std::vector<ProfileThread> threads;
+
+		std::lock_guard<std::mutex> lock(s_RegistryMutex);
+
+		for (auto& buffer : s_Buffers)
+		{
+			ProfileThread thread;
+			thread.Id = buffer->Id;
+			thread.Name = buffer->Name.empty() ? "Thread " + std::to_string(buffer->Id) : buffer->Name;
+
+			uint64_t count = buffer->Count.load(std::memory_order_acquire);
+			uint64_t first = count > EventCapacity ? count - EventCapacity : 0;
+
+			// Events are recorded when they end, walk back until they end before the range. The writer
+			// may lap the reader meanwhile, once a slot is overwritten every older one is too.
+			for (uint64_t idx = count; idx > first; idx--)
+			{
+				ProfileEvent event;
+				if (!ReadEvent(*buffer, idx - 1, event) || event.End < from)
+					break;
+
+				if (event.Start < to)
+					thread.Events.push_back(event);
+			}
+
+			if (thread.Events.empty())
+				continue;
+
+			std::sort(thread.Events.begin(), thread.Events.end(),
+				[](const ProfileEvent& a, const ProfileEvent& b) { return a.Start < b.Start || (a.Start == b.Start && a.Depth < b.Depth); });
+			threads.push_back(std::move(thread));
+		}
+
+		return threads;
+	}
+
+	bool Profiler::ExportChromeTrace(const std::string& path)
+	{
+		std::ofstream out(path, std::ios::trunc);
+		if (!out)
+			return false;
+
+		auto threads = Collect(0, UINT64_MAX);
+
+		out << std::fixed << std::setprecision(3);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		bool first = true;
+		for (auto& thread : threads)
+		{
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.Id << ",\"args\":{\"name\":";
+			WriteJsonString(out, thread.Name);
+			out << "}}";
+			first = false;
+
+			// Complete events, timestamps in microseconds
+			for (auto& event : thread.Events)
+			{
+				out << ",\n{\"name\":";
+				WriteJsonString(out, event.Name);
+				out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.Id
+					<< ",\"ts\":" << event.Start * 0.001 << ",\"dur\":" << (event.End - event.Start) * 0.001 << "}";
+			}
+		}
+
+		out << "\n]}\n";
+		return out.good();
+	}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define WL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define WL_PROFILE_CONCAT(a, b) WL_PROFILE_CONCAT_IMPL(a, b)
+
+// Times the enclosing scope. `name` must be a string literal, only the pointer is stored.
+#define WL_PROFILE_SCOPE(name) ::Walnut::ProfileScope WL_PROFILE_CONCAT(wlProfileScope, __LINE__)(name)
+#define WL_PROFILE_FUNCTION() WL_PROFILE_SCOPE(__func__)
+
+namespace Walnut {
+
+	struct ProfileEvent
+	{
+		const char* Name;
+		// Nanoseconds since the profiler started
+		uint64_t Start, End;
+		// Nesting level within its thread, 0 for outermost scopes
+		uint32_t Depth;
+	};
+
+	struct ProfileThread
+	{
+		uint32_t Id;
+		std::string Name;
+		std::vector<ProfileEvent> Events;
+	};
+
+	// Scoped event profiler. Every thread records into its own ring buffer of the latest
+	// `EventCapacity` events, without locks or allocations. Readers copy the rings concurrently and
+	// skip slots the writer is overwriting, each slot is a seqlock. Disabled by default, a disabled
+	// scope costs one atomic load.
+	class Profiler
+	{
+	public:
+		static constexpr uint32_t EventCapacity = 1 << 15;
+
+		static void SetEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+		static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+		// Names the calling thread in the timeline and in exported traces
+		static void SetThreadName(const std::string& name);
+
+		// Marks the start of a frame, see GetLastFrame
+		static void BeginFrame();
+
+		static uint64_t Now();
+		static void Record(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+		// Events that started between the last two BeginFrame calls, per thread
+		static std::vector<ProfileThread> GetLastFrame();
+		static uint64_t GetLastFrameStart();
+		static uint64_t GetLastFrameEnd();
+
+		// Every event still in the rings, in the Chrome trace event format, for chrome://tracing or Perfetto
+		static bool ExportChromeTrace(const std::string& path);
+
+	private:
+		static std::vector<ProfileThread> Collect(uint64_t from, uint64_t to);
+
+	private:
+		static std::atomic<bool> s_Enabled;
+	};
+
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(const char* name)
+		{
+			if (Profiler::IsEnabled())
+			{
+				m_Name = name;
+				m_Depth = s_Depth++;
+				m_Start = Profiler::Now();
+			}
+		}
+
+		~ProfileScope()
+		{
+			if (m_Name)
+			{
+				s_Depth--;
+				Profiler::Record(m_Name, m_Start, Profiler::Now(), m_Depth);
+			}
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* m_Name = nullptr;
+		uint64_t m_Start = 0;
+		uint32_t m_Depth = 0;
+
+		static thread_local uint32_t s_Depth;
+	};
+
+}
@@ -0,0 +1,148 @@
+#include "ProfilerPanel.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Walnut {
+
+	namespace {
+
+		// Stable color per event name
+		ImU32 EventColor(const char* name)
+		{
+			size_t hash = std::hash<std::string_view>()(name);
+			float hue = (float)(hash % 360) / 360.0f;
+
+			float r, g, b;
+			ImGui::ColorConvertHSVtoRGB(hue, 0.5f, 0.75f, r, g, b);
+			return ImGui::GetColorU32(ImVec4(r, g, b, 1.0f));
+		}
+
+	}
+
+	void ProfilerPanel::OnUIRender()
+	{
+		ImGui::Begin("Profiler");
+
+		bool enabled = Profiler::IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+			Profiler::SetEnabled(enabled);
+		ImGui::SameLine();
+		ImGui::Checkbox("Pause", &m_Paused);
+
+		ImGui::SetNextItemWidth(200.0f);
+		ImGui::InputText("##ExportPath", m_ExportPath, sizeof(m_ExportPath));
+		ImGui::SameLine();
+		if (ImGui::Button("Export trace"))
+			Profiler::ExportChromeTrace(m_ExportPath);
+
+		if (!m_Paused)
+		{
+			m_Frame = Profiler::GetLastFrame();
+			m_FrameStart = Profiler::GetLastFrameStart();
+			m_FrameEnd = Profiler::GetLastFrameEnd();
+		}
+
+		if (m_FrameEnd > m_FrameStart)
+		{
+			ImGui::Text("Frame: %.3fms", (m_FrameEnd - m_FrameStart) * 1e-6);
+			DrawTimeline();
+			DrawSummary();
+		}
+
+		ImGui::End();
+	}
+
+	void ProfilerPanel::DrawTimeline()
+	{
+		const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+		const float labelWidth = 100.0f;
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		float width = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 1.0f);
+		double scale = width / (double)(m_FrameEnd - m_FrameStart);
+
+		for (auto& thread : m_Frame)
+		{
+			uint32_t depthCount = 1;
+			for (auto& event : thread.Events)
+				depthCount = std::max(depthCount, event.Depth + 1);
+
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			ImGui::TextUnformatted(thread.Name.c_str());
+			ImGui::SetCursorScreenPos(origin);
+			ImGui::Dummy({ labelWidth + width, rowHeight * depthCount });
+
+			for (auto& event : thread.Events)
+			{
+				// Clipped to the frame, events may straddle its boundaries
+				uint64_t start = std::max(event.Start, m_FrameStart);
+				uint64_t end = std::min(event.End, m_FrameEnd);
+				if (end < start)
+					continue;
+
+				ImVec2 min = { origin.x + labelWidth + (float)((start - m_FrameStart) * scale), origin.y + event.Depth * rowHeight };
+				ImVec2 max = { std::max(origin.x + labelWidth + (float)((end - m_FrameStart) * scale), min.x + 1.0f), min.y + rowHeight - 1.0f };
+
+				drawList->AddRectFilled(min, max, EventColor(event.Name));
+				if (max.x - min.x > ImGui::CalcTextSize(event.Name).x)
+					drawList->AddText({ min.x + 2.0f, min.y }, IM_COL32_BLACK, event.Name);
+
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s\n%.3fms", event.Name, (event.End - event.Start) * 1e-6);
+			}
+
+			ImGui::Separator();
+		}
+	}
+
+	void ProfilerPanel::DrawSummary()
+	{
+		struct Total
+		{
+			uint32_t Calls = 0;
+			uint64_t Time = 0;
+		};
+
+		std::unordered_map<std::string_view, Total> totals;
+		for (auto& thread : m_Frame)
+		{
+			for (auto& event : thread.Events)
+			{
+				auto& total = totals[event.Name];
+				total.Calls++;
+				total.Time += event.End - event.Start;
+			}
+		}
+
+		std::vector<std::pair<std::string_view, Total>> sorted(totals.begin(), totals.end());
+		std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.Time > b.second.Time; });
+
+		if (ImGui::BeginTable("ProfilerSummary", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+		{
+			ImGui::TableSetupColumn("Event");
+			ImGui::TableSetupColumn("Calls");
+			ImGui::TableSetupColumn("Total (all threads)");
+			ImGui::TableHeadersRow();
+
+			for (auto& [name, total] : sorted)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(name.data(), name.data() + name.size());
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", total.Calls);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3fms", total.Time * 1e-6);
+			}
+
+			ImGui::EndTable();
+		}
+	}
+
+}
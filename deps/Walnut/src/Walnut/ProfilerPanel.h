@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Profiler.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Walnut {
+
+	// ImGui window with a per-thread timeline of the last frame and the time per event name.
+	// Call OnUIRender every frame, the frame shown is frozen while paused.
+	class ProfilerPanel
+	{
+	public:
+		void OnUIRender();
+
+	private:
+		void DrawTimeline();
+		void DrawSummary();
+
+	private:
+		std::vector<ProfileThread> m_Frame;
+		uint64_t m_FrameStart = 0, m_FrameEnd = 0;
+
+		bool m_Paused = false;
+		char m_ExportPath[256] = "trace.json";
+	};
+
+}